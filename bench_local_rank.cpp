@@ -0,0 +1,83 @@
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "local_rank.hpp"
+using namespace std;
+
+// Compara los kernels de ranking local sobre las mismas entradas (sin MPI).
+// Uso: ./bench_local_rank [repeticiones]
+
+template <typename F>
+double medir(int reps, F&& f) {
+    double mejor = 1e30;
+    for (int r = 0; r < reps; r++) {
+        auto inicio = chrono::steady_clock::now();
+        f();
+        auto fin = chrono::steady_clock::now();
+        mejor = min(mejor, chrono::duration<double>(fin - inicio).count());
+    }
+    return mejor;
+}
+
+template <typename T>
+void comparar(const char* nombre, size_t n, size_t m, int reps, mt19937_64& gen) {
+    uniform_int_distribution<int64_t> dist(0, 1LL << 40);
+    vector<T> A(n), local_A(m);
+    for (auto& x : A) x = static_cast<T>(dist(gen));
+    for (auto& x : local_A) x = static_cast<T>(dist(gen));
+    sort(local_A.begin(), local_A.end());
+
+    KernelChoice binary, merge;
+    merge.kernel = RankKernel::Merge;
+
+    vector<int> r_binary, r_merge;
+    double t_binary = medir(reps, [&] { r_binary = local_rank(binary, local_A, A, less<T>()); });
+    double t_merge = medir(reps, [&] { r_merge = local_rank(merge, local_A, A, less<T>()); });
+
+    cout << nombre << "," << n << "," << m << "," << t_binary << "," << t_merge << ","
+         << (r_binary == r_merge ? "ok" : "DIFERENTE") << endl;
+}
+
+// Conteo estable contra lower_bound sobre (llave, índice); local_A tiene índices pares y A impares
+void comparar_conteo(size_t n, size_t m, int reps, mt19937_64& gen) {
+    uniform_int_distribution<int> dist(0, 61);
+    vector<char> A(n), local_A(m);
+    vector<int> idx(n), local_idx(m);
+    for (size_t i = 0; i < n; i++) { A[i] = static_cast<char>('0' + dist(gen)); idx[i] = 2 * i + 1; }
+    for (size_t j = 0; j < m; j++) { local_A[j] = static_cast<char>('0' + dist(gen)); local_idx[j] = 2 * j; }
+
+    IndexedCompare<less<char>> indexed_comp{less<char>()};
+    vector<Indexed<char>> sorted_local_A = with_indices(local_A, local_idx);
+    sort(sorted_local_A.begin(), sorted_local_A.end(), indexed_comp);
+    vector<Indexed<char>> indexed_A = with_indices(A, idx);
+
+    KernelChoice binary;
+    KernelChoice counting = choose_rank_kernel(local_A, A, less<char>());
+
+    vector<int> r_binary, r_counting;
+    double t_binary = medir(reps, [&] { r_binary = local_rank(binary, sorted_local_A, indexed_A, indexed_comp); });
+    double t_counting = medir(reps, [&] {
+        r_counting = local_rank_counting(local_A, local_idx, A, idx, counting.lo, counting.span);
+    });
+
+    cout << "char(conteo)," << n << "," << m << "," << t_binary << "," << t_counting << ","
+         << (counting.kernel == RankKernel::Counting && r_binary == r_counting ? "ok" : "DIFERENTE") << endl;
+}
+
+int main(int argc, char** argv) {
+    int reps = argc > 1 ? atoi(argv[1]) : 5;
+    mt19937_64 gen(42);
+
+    cout << fixed << setprecision(6);
+    cout << "tipo,n,m,t_binary,t_otro,resultado" << endl;
+    for (size_t n = 1 << 10; n <= (1 << 22); n <<= 2) {
+        comparar<int64_t>("int64", n, n, reps, gen);
+        comparar<double>("double", n, n, reps, gen);
+        comparar_conteo(n, n, reps, gen);
+    }
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include <mpi.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "sample_sort.hpp"
+#include "workload.hpp"
+using namespace std;
+
+// Medición repetida de grid_rank_sort (o de sample_sort), fase por fase y en todos los procesos.
+// Uso: mpiexec -n <p> ./benchmark <num_elements> [char|int64|double] [--warmup=W] [--reps=N]
+//          [--csv=prefijo] [--json=archivo] [--distributed] [--pipelined[=chunks]] [--no-compress] [--grid=RxC] [--threads=N]
+//          [--algorithm=rank|sample|auto|both] [--dist=uniform|zipf|few-unique|sorted|reverse|organ-pipe] [--seed=S]
+//
+// Por fase (y el total) se reporta, sobre las repeticiones medidas:
+//  - min/max/mean/median del tiempo crítico: el máximo entre procesos de cada repetición;
+//  - rank_min/rank_max: el promedio por proceso más bajo y más alto, para ver el desbalance.
+// --csv agrega una línea "p, mediana" a <prefijo>_<fase>.txt, el formato de los n=*.txt que lee
+// mediciones_graficas/graphs.py. --json escribe todas las estadísticas de la corrida.
+// --algorithm=both mide los dos algoritmos sobre la misma entrada; los archivos llevan el nombre
+// del algoritmo (<prefijo>_rank_<fase>.txt, archivo_sample.json).
+// La entrada sale de workload.hpp: la misma semilla da la misma entrada con cualquier p.
+
+const int NUM_STATS = NUM_PHASES + 1; // las fases y el total
+
+struct PhaseStats {
+    double min, max, mean, median, rank_min, rank_max;
+};
+
+double mediana(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t m = v.size() / 2;
+    return v.size() % 2 ? v[m] : (v[m - 1] + v[m]) / 2;
+}
+
+// samples[(rank * reps + rep) * NUM_STATS + fase], ya juntadas en el proceso 0
+vector<PhaseStats> estadisticas(const vector<double>& samples, int size, int reps) {
+    vector<PhaseStats> stats(NUM_STATS);
+    for (int j = 0; j < NUM_STATS; ++j) {
+        vector<double> critico(reps, 0), por_proceso(size, 0);
+        for (int r = 0; r < size; ++r) {
+            for (int k = 0; k < reps; ++k) {
+                double t = samples[(r * reps + k) * NUM_STATS + j];
+                critico[k] = max(critico[k], t);
+                por_proceso[r] += t / reps;
+            }
+        }
+        PhaseStats& s = stats[j];
+        s.min = *min_element(critico.begin(), critico.end());
+        s.max = *max_element(critico.begin(), critico.end());
+        s.mean = accumulate(critico.begin(), critico.end(), 0.0) / reps;
+        s.median = mediana(critico);
+        s.rank_min = *min_element(por_proceso.begin(), por_proceso.end());
+        s.rank_max = *max_element(por_proceso.begin(), por_proceso.end());
+    }
+    return stats;
+}
+
+string nombre_estadistica(int j) {
+    return j < NUM_PHASES ? PHASE_NAMES[j] : "total";
+}
+
+void reportar(const vector<PhaseStats>& stats, const string& algorithm, int size, int rows, int cols, long long n,
+              int reps, const string& csv_prefix, const string& json_path) {
+    cout << fixed << setprecision(9);
+    cout << "Algoritmo: " << algorithm << "  malla: " << rows << "x" << cols << "  n: " << n
+         << "  repeticiones: " << reps << endl;
+    cout << left << setw(10) << "fase" << right;
+    for (const char* col : {"min", "max", "mean", "median", "rank_min", "rank_max"}) cout << setw(14) << col;
+    cout << endl;
+    for (int j = 0; j < NUM_STATS; ++j) {
+        const PhaseStats& s = stats[j];
+        cout << left << setw(10) << nombre_estadistica(j) << right << setw(14) << s.min << setw(14) << s.max
+             << setw(14) << s.mean << setw(14) << s.median << setw(14) << s.rank_min << setw(14) << s.rank_max << endl;
+    }
+
+    if (!csv_prefix.empty()) {
+        for (int j = 0; j < NUM_STATS; ++j) {
+            ofstream archivo(csv_prefix + "_" + nombre_estadistica(j) + ".txt", ios::app);
+            archivo << setprecision(12) << size << ", " << stats[j].median << "\n";
+        }
+    }
+
+    if (!json_path.empty()) {
+        ofstream archivo(json_path);
+        archivo << setprecision(12);
+        archivo << "{\"algorithm\": \"" << algorithm << "\", \"processes\": " << size << ", \"rows\": " << rows
+                << ", \"cols\": " << cols << ", \"n\": " << n << ", \"reps\": " << reps << ", \"phases\": {";
+        for (int j = 0; j < NUM_STATS; ++j) {
+            const PhaseStats& s = stats[j];
+            archivo << (j ? ", " : "") << "\"" << nombre_estadistica(j) << "\": {\"min\": " << s.min
+                    << ", \"max\": " << s.max << ", \"mean\": " << s.mean << ", \"median\": " << s.median
+                    << ", \"rank_min\": " << s.rank_min << ", \"rank_max\": " << s.rank_max << "}";
+        }
+        archivo << "}}\n";
+    }
+}
+
+// archivo.json -> archivo_sample.json
+string con_sufijo(const string& path, const string& suffix) {
+    size_t dot = path.rfind('.');
+    if (dot == string::npos || path.find('/', dot) != string::npos) return path + "_" + suffix;
+    return path.substr(0, dot) + "_" + suffix + path.substr(dot);
+}
+
+// Falso si el nombre no es rank, sample ni auto (both se reparte en rank y sample en run)
+bool algoritmo(const string& name, SortAlgorithm& algorithm) {
+    if (name == "rank") algorithm = SortAlgorithm::Rank;
+    else if (name == "sample") algorithm = SortAlgorithm::Sample;
+    else if (name == "auto") algorithm = SortAlgorithm::Auto;
+    else return false;
+    return true;
+}
+
+template <typename T>
+void run(int rank, int size, int rows, int cols, long long n, SortOptions options, int threads, int warmup,
+         int reps, const string& algorithm, const string& csv_prefix, const string& json_path, Distribution dist,
+         uint64_t seed) {
+    vector<T> input = generate_input<T>(MPI_COMM_WORLD, dist, n, seed);
+
+    Grid grid = make_grid(rows, cols);
+    unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool = make_unique<ThreadPool>(threads);
+        options.pool = pool.get();
+    }
+
+    // Con both, los dos algoritmos ordenan la misma entrada
+    bool both = algorithm == "both";
+    vector<string> algorithms = both ? vector<string>{"rank", "sample"} : vector<string>{algorithm};
+    vector<double> medianas;
+    for (const string& name : algorithms) {
+        SortAlgorithm sort_algorithm;
+        algoritmo(name, sort_algorithm);
+        // Cada repetición parte sincronizada; las de calentamiento no se guardan
+        vector<double> local(reps * NUM_STATS);
+        for (int k = -warmup; k < reps; ++k) {
+            MPI_Barrier(grid.comm);
+            double inicio = MPI_Wtime();
+            vector<T> output = distributed_sort(grid, input, less<T>(), options, sort_algorithm);
+            double fin = MPI_Wtime();
+            if (k < 0) continue;
+            phase_durations(&local[k * NUM_STATS]);
+            local[k * NUM_STATS + NUM_PHASES] = fin - inicio;
+        }
+
+        vector<double> samples(rank == 0 ? size * reps * NUM_STATS : 0);
+        MPI_Gather(local.data(), reps * NUM_STATS, MPI_DOUBLE, samples.data(), reps * NUM_STATS, MPI_DOUBLE, 0,
+                   MPI_COMM_WORLD);
+        if (rank == 0) {
+            vector<PhaseStats> stats = estadisticas(samples, size, reps);
+            medianas.push_back(stats[NUM_PHASES].median);
+            reportar(stats, name, size, rows, cols, n, reps,
+                     both && !csv_prefix.empty() ? csv_prefix + "_" + name : csv_prefix,
+                     both && !json_path.empty() ? con_sufijo(json_path, name) : json_path);
+        }
+    }
+    free_grid(grid);
+
+    if (rank == 0 && both) {
+        cout << "Mas rapido: " << (medianas[0] <= medianas[1] ? "rank" : "sample") << " (mediana " << medianas[0]
+             << " contra " << medianas[1] << ")" << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int rows, cols;
+    choose_grid_shape(size, rows, cols);
+
+    if (argc < 2) {
+        if (rank == 0) cerr << "Usage: mpiexec -n <num_processes> ./benchmark <num_elements> [char|int64|double] [--warmup=W] [--reps=N] [--csv=prefix] [--json=file] [--distributed] [--pipelined[=chunks]] [--no-compress] [--grid=RxC] [--threads=N] [--algorithm=rank|sample|auto|both] [--dist=uniform|zipf|few-unique|sorted|reverse|organ-pipe] [--seed=S]" << endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    long long n = atoll(argv[1]);
+    if (n <= 0) {
+        if (rank == 0) cerr << "Error: Number of elements must be a positive integer." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    string key_type = "char", csv_prefix, json_path, algorithm = "rank", dist_name = "uniform";
+    uint64_t seed = DEFAULT_SEED;
+    SortOptions options;
+    int threads = 1, warmup = 2, reps = 10;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--warmup=", 0) == 0) warmup = max(0, atoi(arg.c_str() + 9));
+        else if (arg.rfind("--reps=", 0) == 0) reps = max(1, atoi(arg.c_str() + 7));
+        else if (arg.rfind("--csv=", 0) == 0) csv_prefix = arg.substr(6);
+        else if (arg.rfind("--json=", 0) == 0) json_path = arg.substr(7);
+        else if (arg.rfind("--algorithm=", 0) == 0) algorithm = arg.substr(12);
+        else if (arg.rfind("--dist=", 0) == 0) dist_name = arg.substr(7);
+        else if (arg.rfind("--seed=", 0) == 0) seed = strtoull(arg.c_str() + 7, nullptr, 10);
+        else if (arg == "--distributed") options.output = OutputMode::Distributed;
+        else if (arg == "--pipelined") options.pipelined = true;
+        else if (arg == "--no-compress") options.compress = false;
+        else if (arg.rfind("--pipelined=", 0) == 0) options.pipelined = true, options.chunks_per_block = max(1, atoi(arg.c_str() + 12));
+        else if (arg.rfind("--grid=", 0) == 0) sscanf(arg.c_str(), "--grid=%dx%d", &rows, &cols);
+        else if (arg.rfind("--threads=", 0) == 0) threads = max(1, atoi(arg.c_str() + 10));
+        else key_type = arg;
+    }
+
+    if (rows <= 0 || cols <= 0 || rows * cols != size) {
+        if (rank == 0) cerr << "Error: Grid " << rows << "x" << cols << " doesn't match " << size << " processes." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    if (threads > 1 && provided < MPI_THREAD_FUNNELED) threads = 1;
+    Distribution dist;
+    if (!parse_distribution(dist_name, dist)) {
+        if (rank == 0) cerr << "Error: Unknown distribution '" << dist_name << "' (uniform, zipf, few-unique, sorted, reverse, organ-pipe)." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    SortAlgorithm parsed;
+    if (algorithm != "both" && !algoritmo(algorithm, parsed)) {
+        if (rank == 0) cerr << "Error: Unknown algorithm '" << algorithm << "' (rank, sample, auto, both)." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    if (key_type == "char") {
+        run<char>(rank, size, rows, cols, n, options, threads, warmup, reps, algorithm, csv_prefix, json_path, dist, seed);
+    } else if (key_type == "int64") {
+        run<int64_t>(rank, size, rows, cols, n, options, threads, warmup, reps, algorithm, csv_prefix, json_path, dist, seed);
+    } else if (key_type == "double") {
+        run<double>(rank, size, rows, cols, n, options, threads, warmup, reps, algorithm, csv_prefix, json_path, dist, seed);
+    } else {
+        if (rank == 0) cerr << "Error: Unknown key type '" << key_type << "' (char, int64, double)." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+
+    MPI_Finalize();
+    return 0;
+}
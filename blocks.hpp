@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cmath>
+
+// Forma de la malla y reparto en bloques, comunes a la versión MPI (main.cpp) y al motor con hilos
+// (threaded_rank_sort.hpp).
+
+// Factorización rows x cols de p lo más cuadrada posible (rows <= cols); con p primo queda 1 x p.
+inline void choose_grid_shape(int size, int& rows, int& cols) {
+    rows = static_cast<int>(std::sqrt(size));
+    while (size % rows != 0) --rows;
+    cols = size / rows;
+}
+
+// Reparto balanceado de n llaves en p bloques: el bloque i es [i*n/p, (i+1)*n/p),
+// así que los tamaños difieren a lo más en uno. Lo usan la entrada y la salida distribuida.
+inline long long block_start(int i, long long n, int p) {
+    return i * n / p;
+}
+
+inline int block_size(int i, long long n, int p) {
+    return static_cast<int>(block_start(i + 1, n, p) - block_start(i, n, p));
+}
+
+// Proceso dueño de la posición pos en el reparto [i*n/p, (i+1)*n/p)
+inline int block_owner(long long pos, long long n, int p) {
+    return static_cast<int>(((pos + 1) * p - 1) / n);
+}
@@ -0,0 +1,68 @@
+#include <mpi.h>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "cost_model.hpp"
+using namespace std;
+
+// Calibración del modelo de costo (ver cost_model.hpp): mide alpha, beta y las constantes de los
+// kernels en esta máquina, las guarda para main.cpp --autotune y muestra el tiempo predicho.
+// Uso: mpiexec -n <p> ./calibrate [num_elements] [--out=modelo.txt] [--keys=M] [--bytes=B] [--csv=archivo]
+//
+// Con --csv escribe "p, T" para p = 1, 4, 9, ..., 64, el formato de los n=*.txt que lee
+// mediciones_graficas/graphs.py (como calculos1.cpp y calculos2.cpp, pero con constantes medidas).
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    long long n = 14400;
+    string out = "modelo.txt", csv;
+    size_t keys = 1 << 16;
+    int key_bytes = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--out=", 0) == 0) out = arg.substr(6);
+        else if (arg.rfind("--keys=", 0) == 0) keys = max(1024, atoi(arg.c_str() + 7));
+        else if (arg.rfind("--bytes=", 0) == 0) key_bytes = max(1, atoi(arg.c_str() + 8));
+        else if (arg.rfind("--csv=", 0) == 0) csv = arg.substr(6);
+        else n = max(1LL, atoll(arg.c_str()));
+    }
+
+    CostModel model = calibrate(MPI_COMM_WORLD, keys);
+
+    if (rank == 0) {
+        if (!save_cost_model(out, model)) cerr << "Error: Can't write '" << out << "'." << endl;
+
+        cout << scientific << setprecision(4);
+        cout << "alpha: " << model.alpha << " s" << endl;
+        cout << "beta: " << model.beta << " s/byte" << endl;
+        cout << "sort: " << model.sort << " s/(m log m)" << endl;
+        cout << "binary: " << model.binary << " s/(fila log columna)" << endl;
+        cout << "merge: " << model.merge << " s/llave" << endl;
+        cout << "counting: " << model.counting << " s/llave" << endl;
+        cout << "place: " << model.place << " s/llave" << endl;
+
+        // Predicción con la mejor configuración para cada p
+        ofstream file;
+        if (!csv.empty()) file.open(csv);
+        cout << fixed << setprecision(10);
+        cout << "n = " << n << endl;
+        for (int q = 1; q <= 8; ++q) {
+            int p = q * q;
+            Tuning best = autotune(model, n, p, key_bytes, 1, OutputMode::Gather);
+            cout << "p = " << p << ": " << best.predicted << " s (" << best.rows << "x" << best.cols << ", "
+                 << kernel_name(best.kernel) << (best.pipelined ? ", pipelined" : "") << ")" << endl;
+            if (file.is_open()) file << p << ", " << best.predicted << "\n";
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
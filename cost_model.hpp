@@ -0,0 +1,303 @@
+#pragma once
+
+#include <mpi.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <numeric>
+#include <cstdint>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+
+#include "grid_rank_sort.hpp"
+
+// Modelo de costo calibrado y autotuner. Generaliza las fórmulas de mediciones_graficas/calculos1.cpp
+// y calculos2.cpp (términos alpha + m*beta por mensaje y m log m de cómputo) con constantes medidas
+// en la máquina en vez de alpha = 2, beta = 3, x = 5:
+//  - calibrate(): ping-pong entre dos procesos (alpha, beta) y microbenchmarks de los kernels locales.
+//  - predict():   tiempo por fase de una configuración (malla rows x cols, kernel, pipelined).
+//  - autotune():  la configuración de menor tiempo predicho para n y p.
+//  - sample_sort_crossover(): desde qué n conviene sample_sort (sample_sort.hpp) para p procesos.
+
+// Constantes de la máquina, en segundos
+struct CostModel {
+    double alpha = 0;    // latencia por mensaje
+    double beta = 0;     // tiempo por byte
+    double sort = 0;     // sort de pares (llave, índice), por m log2 m
+    double binary = 0;   // ranking binario, por fila * log2 columna
+    double merge = 0;    // ranking por mezcla, por fila + columna
+    double counting = 0; // ranking por conteo, por fila + columna
+    double place = 0;    // ubicación por rank, por llave
+};
+
+// Configuración elegida por el autotuner
+struct Tuning {
+    int rows = 1, cols = 1;
+    RankKernel kernel = RankKernel::Binary;
+    bool pipelined = false;
+    double predicted = 0; // segundos
+};
+
+inline const char* kernel_name(RankKernel kernel) {
+    switch (kernel) {
+    case RankKernel::Merge: return "merge";
+    case RankKernel::Counting: return "counting";
+    default: return "binary";
+    }
+}
+
+// Ajuste por mínimos cuadrados de t = alpha + beta * bytes
+inline void fit_latency_bandwidth(const std::vector<double>& bytes, const std::vector<double>& times,
+                                  double& alpha, double& beta) {
+    double k = bytes.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        sx += bytes[i];
+        sy += times[i];
+        sxx += bytes[i] * bytes[i];
+        sxy += bytes[i] * times[i];
+    }
+    beta = std::max(0.0, (k * sxy - sx * sy) / (k * sxx - sx * sx));
+    alpha = std::max(0.0, (sy - beta * sx) / k);
+}
+
+// Ping-pong entre el proceso 0 y el último (en otro nodo si los procesos se reparten por bloques)
+inline void calibrate_network(MPI_Comm comm, double& alpha, double& beta) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    alpha = beta = 0;
+    if (size == 1) return;
+
+    int peer = rank == 0 ? size - 1 : 0;
+    bool active = rank == 0 || rank == size - 1;
+    std::vector<double> bytes, times;
+    std::vector<char> buffer(1 << 20);
+    for (int length = 8; length <= (1 << 20); length *= 8) {
+        int reps = length < (1 << 16) ? 50 : 10;
+        MPI_Barrier(comm);
+        if (!active) continue;
+        double start = MPI_Wtime();
+        for (int k = 0; k < reps; ++k) {
+            if (rank == 0) {
+                MPI_Send(buffer.data(), length, MPI_CHAR, peer, 0, comm);
+                MPI_Recv(buffer.data(), length, MPI_CHAR, peer, 0, comm, MPI_STATUS_IGNORE);
+            } else {
+                MPI_Recv(buffer.data(), length, MPI_CHAR, peer, 0, comm, MPI_STATUS_IGNORE);
+                MPI_Send(buffer.data(), length, MPI_CHAR, peer, 0, comm);
+            }
+        }
+        bytes.push_back(length);
+        times.push_back((MPI_Wtime() - start) / (2 * reps));
+    }
+    if (rank == 0) fit_latency_bandwidth(bytes, times, alpha, beta);
+    double fitted[2] = {alpha, beta};
+    MPI_Bcast(fitted, 2, MPI_DOUBLE, 0, comm);
+    alpha = fitted[0];
+    beta = fitted[1];
+}
+
+// Mejor de reps ejecuciones de f
+template <typename F>
+double best_time(int reps, F&& f) {
+    double best = 1e30;
+    for (int k = 0; k < reps; ++k) {
+        double start = MPI_Wtime();
+        f();
+        best = std::min(best, MPI_Wtime() - start);
+    }
+    return best;
+}
+
+// Kernels locales sobre m llaves int64 por lado; manda el proceso más lento
+inline void calibrate_kernels(MPI_Comm comm, size_t m, CostModel& model) {
+    std::mt19937_64 gen(12345);
+    std::vector<int64_t> column(m), row(m), small(m);
+    std::vector<int> column_idx(m), row_idx(m);
+    for (size_t i = 0; i < m; ++i) {
+        column[i] = static_cast<int64_t>(gen());
+        row[i] = static_cast<int64_t>(gen());
+        small[i] = static_cast<int64_t>(gen() % 256);
+        column_idx[i] = 2 * i;
+        row_idx[i] = 2 * i + 1;
+    }
+    IndexedCompare<std::less<int64_t>> comp{std::less<int64_t>()};
+    std::vector<Indexed<int64_t>> unsorted = with_indices(column, column_idx), sorted;
+    std::vector<Indexed<int64_t>> indexed_row = with_indices(row, row_idx);
+    double log_m = std::log2(static_cast<double>(m));
+
+    double local[5];
+    local[0] = best_time(3, [&] {
+        sorted = unsorted;
+        std::sort(sorted.begin(), sorted.end(), comp);
+    }) / (m * log_m);
+
+    KernelChoice binary, merge;
+    merge.kernel = RankKernel::Merge;
+    local[1] = best_time(3, [&] { local_rank(nullptr, binary, sorted, indexed_row, comp); }) / (m * log_m);
+    local[2] = best_time(3, [&] { local_rank(nullptr, merge, sorted, indexed_row, comp); }) / (2 * m);
+    local[3] = best_time(3, [&] {
+        local_rank_counting(nullptr, KeySpan<int64_t>(small), column_idx, KeySpan<int64_t>(small), row_idx, 0, 256);
+    }) / (2 * m);
+
+    std::vector<int> permutation(m);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), gen);
+    std::vector<int64_t> placed;
+    local[4] = best_time(3, [&] { sort_and_print_by_rank(permutation, row, 0, nullptr, placed); }) / m;
+
+    double slowest[5];
+    MPI_Allreduce(local, slowest, 5, MPI_DOUBLE, MPI_MAX, comm);
+    model.sort = slowest[0];
+    model.binary = slowest[1];
+    model.merge = slowest[2];
+    model.counting = slowest[3];
+    model.place = slowest[4];
+}
+
+// Colectiva; todos los procesos terminan con el mismo modelo
+inline CostModel calibrate(MPI_Comm comm, size_t kernel_keys = 1 << 16) {
+    CostModel model;
+    calibrate_network(comm, model.alpha, model.beta);
+    calibrate_kernels(comm, kernel_keys, model);
+    return model;
+}
+
+inline bool save_cost_model(const std::string& path, const CostModel& model) {
+    std::ofstream file(path);
+    file.precision(12);
+    file << "alpha " << model.alpha << "\nbeta " << model.beta << "\nsort " << model.sort << "\nbinary "
+         << model.binary << "\nmerge " << model.merge << "\ncounting " << model.counting << "\nplace "
+         << model.place << "\n";
+    return static_cast<bool>(file);
+}
+
+// Formato "nombre valor" por línea, como lo escribe save_cost_model
+inline bool load_cost_model(const std::string& path, CostModel& model) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string name;
+    double value;
+    while (file >> name >> value) {
+        if (name == "alpha") model.alpha = value;
+        else if (name == "beta") model.beta = value;
+        else if (name == "sort") model.sort = value;
+        else if (name == "binary") model.binary = value;
+        else if (name == "merge") model.merge = value;
+        else if (name == "counting") model.counting = value;
+        else if (name == "place") model.place = value;
+    }
+    return true;
+}
+
+/**
+ * @brief Tiempo predicho de cada fase (en el orden de PHASE_NAMES) y total.
+ *
+ * Colectivas en anillo: (q - 1) mensajes y lo que llega de los otros q - 1 procesos. El cómputo
+ * se divide entre los hilos del pool. En modo pipelined el gossip y el broadcast se solapan con el
+ * sort y el ranking, a cambio de un mensaje más por tramo.
+ *
+ * @param key_bytes sizeof de la llave
+ */
+inline double predict(const CostModel& model, long long n, int key_bytes, const Tuning& config, int threads,
+                      OutputMode output, double* phases = nullptr) {
+    int p = config.rows * config.cols;
+    double m = static_cast<double>(n) / p;                // bloque propio
+    double column = static_cast<double>(n) / config.cols; // llaves en la columna
+    double row = static_cast<double>(n) / config.rows;    // llaves en la fila
+    double compute_share = 1.0 / std::max(1, threads);
+    auto ring = [&](int q, double bytes) { return (q - 1) * model.alpha + bytes * model.beta; };
+
+    double t[NUM_PHASES] = {};
+    t[PHASE_SCATTER] = ring(p, (n - m) * key_bytes);
+    t[PHASE_GOSSIP] = ring(config.rows, (column - m) * key_bytes);
+    t[PHASE_BROADCAST] = ring(config.cols, (row - m) * key_bytes);
+    if (config.kernel != RankKernel::Counting) t[PHASE_SORT] = model.sort * column * std::log2(std::max(column, 2.0)) * compute_share;
+    switch (config.kernel) {
+    case RankKernel::Merge: t[PHASE_RANK] = model.merge * (row + column) * compute_share; break;
+    case RankKernel::Counting: t[PHASE_RANK] = model.counting * (row + column) * compute_share; break;
+    default: t[PHASE_RANK] = model.binary * row * std::log2(std::max(column, 2.0)) * compute_share; break;
+    }
+    t[PHASE_REDUCE] = ring(config.cols, (row - m) * sizeof(int));
+    if (output == OutputMode::Gather) {
+        t[PHASE_GATHER] = 2 * (p - 1) * model.alpha + (n - m) * (key_bytes + sizeof(int)) * model.beta;
+        t[PHASE_PLACEMENT] = model.place * n * compute_share;
+    } else {
+        t[PHASE_PLACEMENT] = ring(p, m * (key_bytes + sizeof(int))) + model.place * m * compute_share;
+    }
+
+    if (config.pipelined) {
+        // Un Ibcast por tramo de cada bloque de la fila
+        double chunks = SortOptions().chunks_per_block * config.cols * model.alpha;
+        double communication = t[PHASE_GOSSIP] + t[PHASE_BROADCAST] + chunks;
+        double computation = t[PHASE_SORT] + t[PHASE_RANK];
+        double overlapped = std::max(communication, computation);
+        t[PHASE_GOSSIP] = t[PHASE_BROADCAST] = 0;
+        t[PHASE_SORT] = overlapped - t[PHASE_RANK];
+    }
+
+    double total = 0;
+    for (int i = 0; i < NUM_PHASES; ++i) {
+        total += t[i];
+        if (phases) phases[i] = t[i];
+    }
+    return total;
+}
+
+// Prueba todas las mallas rows x cols de p procesos, con los dos kernels de comparación y con y sin
+// solapamiento. El conteo no entra: depende del rango de llaves y la heurística lo elige igual.
+inline Tuning autotune(const CostModel& model, long long n, int p, int key_bytes, int threads, OutputMode output) {
+    Tuning best;
+    best.predicted = 1e300;
+    for (int rows = 1; rows <= p; ++rows) {
+        if (p % rows) continue;
+        for (RankKernel kernel : {RankKernel::Binary, RankKernel::Merge}) {
+            for (bool pipelined : {false, true}) {
+                Tuning config;
+                config.rows = rows;
+                config.cols = p / rows;
+                config.kernel = kernel;
+                config.pipelined = pipelined;
+                config.predicted = predict(model, n, key_bytes, config, threads, output);
+                if (config.predicted < best.predicted) best = config;
+            }
+        }
+    }
+    return best;
+}
+
+// Deja la configuración en options; la malla la arma quien llama con config.rows x config.cols
+inline void apply_tuning(const Tuning& config, SortOptions& options) {
+    options.pipelined = config.pipelined;
+    options.auto_kernel = false;
+    options.kernel = config.kernel;
+}
+
+// Tiempo predicho de sample_sort en p procesos: sort local, muestreo (p(p - 1) muestras), Alltoallv
+// de n/p llaves y mezcla de p tramos
+inline double predict_sample_sort(const CostModel& model, long long n, int p, int key_bytes, int threads,
+                                  OutputMode output) {
+    double m = static_cast<double>(n) / p;
+    double compute_share = 1.0 / std::max(1, threads);
+    double all_samples = static_cast<double>(p) * (p - 1);
+    auto ring = [&](double bytes) { return (p - 1) * model.alpha + bytes * model.beta; };
+
+    double t = ring((n - m) * key_bytes);
+    t += model.sort * m * std::log2(std::max(m, 2.0)) * compute_share;
+    t += 2 * ring(all_samples * (key_bytes + sizeof(int))) + model.sort * all_samples * std::log2(std::max(all_samples, 2.0));
+    t += ring(0) + ring(m * key_bytes);
+    t += model.sort * m * std::log2(std::max(p, 2)) * compute_share;
+    t += ring(0) + (output == OutputMode::Gather ? ring((n - m) * key_bytes) : ring(m * key_bytes));
+    return t;
+}
+
+// Menor n (potencia de 2) desde el que sample sort le gana a la mejor configuración del ranking;
+// es el crossover de distributed_sort con SortAlgorithm::Auto
+inline long long sample_sort_crossover(const CostModel& model, int p, int key_bytes, int threads, OutputMode output) {
+    for (long long n = 1 << 8; n <= (1LL << 40); n *= 2) {
+        double rank = autotune(model, n, p, key_bytes, threads, output).predicted;
+        if (predict_sample_sort(model, n, p, key_bytes, threads, output) < rank) return n;
+    }
+    return 1LL << 40;
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <mpi.h>
+#include <queue>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "grid_rank_sort.hpp"
+#include "mpi_file_io.hpp"
+
+// Modo fuera de memoria: ordena un archivo más grande que la memoria de todos los procesos juntos.
+//  1. Corridas: la entrada se lee por tramos consecutivos que caben en el presupuesto de memoria;
+//     cada tramo pasa por rank_sort (salida distribuida) y se escribe ordenado en un archivo de
+//     corrida en spill_dir. De cada corrida se guardan p muestras por proceso.
+//  2. Mezcla distribuida: con las muestras se eligen p - 1 splitters; cada proceso busca en cada
+//     corrida el tramo entre sus dos splitters (búsqueda binaria en el archivo), los mezcla con un
+//     heap de k vías leyendo por buffers y escribe el resultado en su lugar del archivo de salida.
+// El orden es (llave, corrida, posición), así que llaves iguales se reparten entre procesos y el
+// resultado es estable, como el de rank_sort sobre la entrada completa. Cada proceso lee los tramos
+// de corrida que le tocan directo del archivo, por eso spill_dir debe verlo todo proceso (disco
+// local si es un solo nodo, un scratch compartido en un cluster).
+
+struct ExternalSortOptions {
+    size_t memory_budget = size_t(1) << 28; // bytes por proceso
+    std::string spill_dir = "/tmp";
+    SortOptions sort;                       // opciones de rank_sort en cada corrida (la salida siempre es distribuida)
+};
+
+// Tiempos de la última llamada
+inline double t_runs, t_merge;
+
+// Llaves por corrida (de todos los procesos) que caben en budget bytes por proceso: columna y fila
+// con sus índices y pares ordenados, y el bloque propio con sus ranks y buffers de reparto
+template <typename T>
+long long run_keys_for_budget(const Grid& grid, size_t budget) {
+    int size = grid.rows * grid.cols;
+    double per_key = (sizeof(T) + sizeof(int) + sizeof(Indexed<T>)) / double(grid.cols)
+                   + (sizeof(T) + 2 * sizeof(int) + sizeof(Indexed<T>)) / double(grid.rows)
+                   + (3 * sizeof(T) + 3 * sizeof(int) + 2 * (sizeof(T) + sizeof(int))) / double(size);
+    return std::max<long long>(size, static_cast<long long>(budget / per_key));
+}
+
+// Prefijo de los archivos de corrida de una llamada: PID del proceso 0, hora y un número aleatorio,
+// difundidos desde el proceso 0. Dos trabajos (o dos llamadas) con el mismo spill_dir no se pisan
+// ni se borran las corridas.
+inline std::string spill_prefix(MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    unsigned long long id[3] = {0, 0, 0};
+    if (rank == 0) {
+        id[0] = static_cast<unsigned long long>(getpid());
+        id[1] = static_cast<unsigned long long>(std::chrono::system_clock::now().time_since_epoch().count());
+        id[2] = std::random_device{}();
+    }
+    MPI_Bcast(id, 3, MPI_UNSIGNED_LONG_LONG, 0, comm);
+    char prefix[80];
+    std::snprintf(prefix, sizeof(prefix), "rank_sort_%llu_%llx_%llx", id[0], id[1], id[2]);
+    return prefix;
+}
+
+// Posición de un elemento en el orden total de la mezcla
+template <typename T>
+struct RunKey {
+    T key;
+    int run;
+    long long pos;
+};
+
+template <typename T, typename Compare>
+bool run_key_less(const RunKey<T>& a, const RunKey<T>& b, Compare comp) {
+    if (comp(a.key, b.key)) return true;
+    if (comp(b.key, a.key)) return false;
+    return a.run != b.run ? a.run < b.run : a.pos < b.pos;
+}
+
+// Elementos de la corrida run (ordenada, length llaves) anteriores a s en el orden (llave, corrida, posición)
+template <typename T, typename Compare>
+long long count_before(MPI_File file, int run, long long length, const RunKey<T>& s, Compare comp) {
+    if (run == s.run) return s.pos;
+    long long lo = 0, hi = length;
+    while (lo < hi) {
+        long long mid = lo + (hi - lo) / 2;
+        RunKey<T> e;
+        MPI_File_read_at(file, mid * sizeof(T), &e.key, 1, mpi_type<T>::get(), MPI_STATUS_IGNORE);
+        e.run = run;
+        e.pos = mid;
+        if (run_key_less(e, s, comp)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Lectura por buffers del tramo [begin, end) de una corrida
+template <typename T>
+struct RunReader {
+    MPI_File file;
+    long long next, end;
+    std::vector<T> buffer;
+    size_t used = 0;
+
+    bool refill(size_t capacity) {
+        int count = static_cast<int>(std::min<long long>(capacity, end - next));
+        buffer.resize(count);
+        used = 0;
+        if (count == 0) return false;
+        MPI_File_read_at(file, next * sizeof(T), buffer.data(), count, mpi_type<T>::get(), MPI_STATUS_IGNORE);
+        next += count;
+        return true;
+    }
+};
+
+// Ordena cada corrida con rank_sort y la escribe en run_path(run); guarda el largo de cada corrida y
+// p muestras por proceso de su tramo. El workspace y el bloque se liberan al volver, antes de la mezcla.
+template <typename T, typename Compare, typename RunPath>
+bool sort_runs(const Grid& grid, MPI_File input, long long n, long long run_keys, RunPath run_path, Compare comp,
+               SortOptions options, std::vector<long long>& run_length, std::vector<RunKey<T>>& samples) {
+    int size = grid.rows * grid.cols;
+    options.output = OutputMode::Distributed;
+    SortWorkspace<T> ws;
+    std::vector<T> block;
+    for (size_t run = 0; run < run_length.size(); ++run) {
+        long long first = run * run_keys;
+        long long length = std::min(run_keys, n - first);
+        run_length[run] = length;
+
+        long long my_first = block_start(grid.rank, length, size);
+        block.resize(block_size(grid.rank, length, size));
+        MPI_File_read_at_all(input, (first + my_first) * sizeof(T), block.data(), static_cast<int>(block.size()),
+                             mpi_type<T>::get(), MPI_STATUS_IGNORE);
+
+        KeySpan<T> sorted = rank_sort(grid, KeySpan<T>(block), ws, comp, options);
+
+        for (int k = 0; k < size && !sorted.empty(); ++k) {
+            size_t i = sorted.size() * k / size;
+            samples.push_back({sorted[i], static_cast<int>(run), my_first + static_cast<long long>(i)});
+        }
+
+        if (!write_block(grid.comm, run_path(run), sorted, my_first)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Ordena el archivo input_path en output_path con memoria acotada por proceso.
+ *
+ * Mismo formato que read_block/write_block (arreglo binario de llaves). Colectiva sobre grid.comm.
+ *
+ * @return false si no se pudo abrir la entrada o crear un archivo.
+ */
+template <typename T, typename Compare = std::less<T>>
+bool external_rank_sort(const Grid& grid, const std::string& input_path, const std::string& output_path,
+                        Compare comp = Compare(), const ExternalSortOptions& options = ExternalSortOptions()) {
+    int size = grid.rows * grid.cols;
+    t_runs = MPI_Wtime();
+
+    MPI_File input;
+    if (MPI_File_open(grid.comm, input_path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &input) != MPI_SUCCESS) return false;
+    MPI_Offset bytes;
+    MPI_File_get_size(input, &bytes);
+    long long n = bytes / static_cast<MPI_Offset>(sizeof(T));
+    long long run_keys = run_keys_for_budget<T>(grid, options.memory_budget);
+    int runs = static_cast<int>((n + run_keys - 1) / run_keys);
+
+    std::string prefix = options.spill_dir + "/" + spill_prefix(grid.comm);
+    auto run_path = [&](int run) { return prefix + "_run_" + std::to_string(run) + ".bin"; };
+
+    // CORRIDAS
+
+    std::vector<long long> run_length(runs);
+    std::vector<RunKey<T>> samples;
+    bool ok = sort_runs(grid, input, n, run_keys, run_path, comp, options.sort, run_length, samples);
+    MPI_File_close(&input);
+    if (!ok) return false;
+    t_runs = MPI_Wtime() - t_runs;
+
+    // MEZCLA
+
+    t_merge = MPI_Wtime();
+
+    // Splitters: las muestras de todos, ordenadas, cada total/p
+    int local_samples = static_cast<int>(samples.size());
+    std::vector<int> sample_counts(size), sample_displs(size, 0);
+    MPI_Allgather(&local_samples, 1, MPI_INT, sample_counts.data(), 1, MPI_INT, grid.comm);
+    std::partial_sum(sample_counts.begin(), sample_counts.end() - 1, sample_displs.begin() + 1);
+    int total_samples = sample_displs[size - 1] + sample_counts[size - 1];
+    std::vector<RunKey<T>> all_samples(total_samples);
+    MPI_Datatype run_key_type;
+    MPI_Type_contiguous(sizeof(RunKey<T>), MPI_BYTE, &run_key_type);
+    MPI_Type_commit(&run_key_type);
+    MPI_Allgatherv(samples.data(), local_samples, run_key_type, all_samples.data(), sample_counts.data(),
+                   sample_displs.data(), run_key_type, grid.comm);
+    MPI_Type_free(&run_key_type);
+    auto less = [&](const RunKey<T>& a, const RunKey<T>& b) { return run_key_less(a, b, comp); };
+    std::sort(all_samples.begin(), all_samples.end(), less);
+
+    // Tramo propio de cada corrida: entre el splitter rank - 1 y el splitter rank
+    std::vector<RunReader<T>> readers(runs);
+    long long my_count = 0;
+    for (int run = 0; run < runs; ++run) {
+        RunReader<T>& r = readers[run];
+        MPI_File_open(MPI_COMM_SELF, run_path(run).c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &r.file);
+        r.next = 0;
+        r.end = run_length[run];
+        if (grid.rank > 0) {
+            r.next = count_before(r.file, run, run_length[run], all_samples[total_samples * grid.rank / size], comp);
+        }
+        if (grid.rank < size - 1) {
+            r.end = count_before(r.file, run, run_length[run], all_samples[total_samples * (grid.rank + 1) / size], comp);
+        }
+        my_count += r.end - r.next;
+    }
+    long long my_offset = 0;
+    MPI_Exscan(&my_count, &my_offset, 1, MPI_LONG_LONG, MPI_SUM, grid.comm);
+    if (grid.rank == 0) my_offset = 0;
+
+    MPI_File output;
+    if (MPI_File_open(grid.comm, output_path.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &output)
+        != MPI_SUCCESS) {
+        for (RunReader<T>& r : readers) MPI_File_close(&r.file);
+        return false;
+    }
+    MPI_File_set_size(output, 0);
+
+    // k buffers de lectura y uno de escritura dentro del presupuesto
+    size_t capacity = std::max<size_t>(1, options.memory_budget / ((runs + 1) * sizeof(T)));
+    auto heap_greater = [&](const std::pair<T, int>& a, const std::pair<T, int>& b) {
+        if (comp(a.first, b.first)) return false;
+        if (comp(b.first, a.first)) return true;
+        return a.second > b.second;
+    };
+    std::priority_queue<std::pair<T, int>, std::vector<std::pair<T, int>>, decltype(heap_greater)> heap(heap_greater);
+    for (int run = 0; run < runs; ++run) {
+        if (readers[run].refill(capacity)) heap.push({readers[run].buffer[0], run});
+    }
+
+    std::vector<T> out;
+    out.reserve(capacity);
+    long long written = 0;
+    auto flush = [&] {
+        MPI_File_write_at(output, (my_offset + written) * sizeof(T), out.data(), static_cast<int>(out.size()),
+                          mpi_type<T>::get(), MPI_STATUS_IGNORE);
+        written += out.size();
+        out.clear();
+    };
+    while (!heap.empty()) {
+        auto [key, run] = heap.top();
+        heap.pop();
+        out.push_back(key);
+        if (out.size() == capacity) flush();
+
+        RunReader<T>& r = readers[run];
+        if (++r.used < r.buffer.size() || r.refill(capacity)) heap.push({r.buffer[r.used], run});
+    }
+    flush();
+
+    for (RunReader<T>& r : readers) MPI_File_close(&r.file);
+    MPI_File_close(&output);
+    MPI_Barrier(grid.comm);
+    if (grid.rank == 0) {
+        for (int run = 0; run < runs; ++run) MPI_File_delete(run_path(run).c_str(), MPI_INFO_NULL);
+    }
+    t_merge = MPI_Wtime() - t_merge;
+    return true;
+}
@@ -0,0 +1,1264 @@
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#include "blocks.hpp"
+#include "local_rank.hpp"
+#include "key_codec.hpp"
+#include "large_count.hpp"
+
+// Ordenamiento por ranking en una malla de procesos MPI, como biblioteca. Dos entradas:
+//  - grid_rank_sort(grid, input, ...): el proceso 0 aporta la entrada completa (la usa main.cpp).
+//  - rank_sort(comm, local_input, workspace, ...): cada proceso aporta un tramo de la entrada y
+//    recibe un tramo de la salida; con un SortWorkspace persistente, ordenar de nuevo con tamaños
+//    parecidos no vuelve a asignar memoria.
+// n puede pasar de 2^31: desde RANK32_MAX_N los ranks globales van en int64_t y las colectivas del
+// proceso 0 con las n llaves usan large_count.hpp. Los buffers por proceso (bloque, columna, fila)
+// siguen contados en int y deben quedar bajo 2^31 elementos.
+
+// Tiempos (MPI_Wtime) de cada fase de la última llamada. En double: en float se pierde la
+// resolución de MPI_Wtime y las fases de menos de un milisegundo quedan en ruido.
+inline double t1, t2, t3, t4, t5, t6, t7, t8;
+inline double t9, t10, t11, t12, t13, t14, t15, t16;
+
+// Fases medidas, en el orden de los pares (t1, t2), (t3, t4), ..., (t15, t16). PHASE_OTHER junta lo
+// que queda fuera de ellas (el Bcast de n, el conteo de entradas de rank_sort)
+enum Phase {
+    PHASE_SCATTER, PHASE_GOSSIP, PHASE_BROADCAST, PHASE_SORT,
+    PHASE_RANK, PHASE_REDUCE, PHASE_GATHER, PHASE_PLACEMENT, PHASE_OTHER
+};
+const int NUM_PHASES = PHASE_OTHER;
+inline const char* const PHASE_NAMES[NUM_PHASES + 1] = {"scatter", "gossip", "broadcast", "sort",
+                                                        "rank", "reduce", "gather", "placement", "other"};
+
+// Fase en curso: a ella se atribuye la comunicación medida por mpi_profile.cpp
+inline int current_phase = PHASE_OTHER;
+
+inline double begin_phase(Phase phase) {
+    current_phase = phase;
+    return MPI_Wtime();
+}
+
+// Cada llamada parte con los tiempos en cero: las fases que no corren (el gather con salida
+// distribuida, la ubicación en argsort) miden 0 y no arrastran la llamada anterior
+inline void reset_phase_timers() {
+    t1 = t2 = t3 = t4 = t5 = t6 = t7 = t8 = 0;
+    t9 = t10 = t11 = t12 = t13 = t14 = t15 = t16 = 0;
+    current_phase = PHASE_OTHER;
+}
+
+// Duración de cada fase de la última llamada en este proceso
+inline void phase_durations(double* out) {
+    const double starts[NUM_PHASES] = {t1, t3, t5, t7, t9, t11, t13, t15};
+    const double ends[NUM_PHASES] = {t2, t4, t6, t8, t10, t12, t14, t16};
+    for (int i = 0; i < NUM_PHASES; ++i) out[i] = ends[i] - starts[i];
+}
+
+// Tipo MPI asociado a cada tipo de llave. Los tipos sin equivalente nativo
+// (registros de ancho fijo) viajan como un bloque contiguo de sizeof(T) bytes.
+template <typename T>
+struct mpi_type {
+    static_assert(std::is_trivially_copyable<T>::value, "Las llaves deben ser trivially copyable");
+    static MPI_Datatype get() {
+        static MPI_Datatype type = [] {
+            MPI_Datatype t;
+            MPI_Type_contiguous(sizeof(T), MPI_BYTE, &t);
+            MPI_Type_commit(&t);
+            return t;
+        }();
+        return type;
+    }
+};
+template <> struct mpi_type<char>     { static MPI_Datatype get() { return MPI_CHAR; } };
+template <> struct mpi_type<int32_t>  { static MPI_Datatype get() { return MPI_INT32_T; } };
+template <> struct mpi_type<int64_t>  { static MPI_Datatype get() { return MPI_INT64_T; } };
+template <> struct mpi_type<uint32_t> { static MPI_Datatype get() { return MPI_UINT32_T; } };
+template <> struct mpi_type<uint64_t> { static MPI_Datatype get() { return MPI_UINT64_T; } };
+template <> struct mpi_type<float>    { static MPI_Datatype get() { return MPI_FLOAT; } };
+template <> struct mpi_type<double>   { static MPI_Datatype get() { return MPI_DOUBLE; } };
+
+// Malla rows x cols de procesos. row_comm agrupa los procesos de una fila (ordenados por columna)
+// y col_comm los de una columna (ordenados por fila), para usar colectivas en cada fase.
+// comm es el comunicador de todos los procesos de la malla (no se duplica ni se libera).
+struct Grid {
+    int rank, rows, cols, row, col;
+    MPI_Comm comm, row_comm, col_comm;
+};
+
+inline Grid make_grid(MPI_Comm comm, int rows, int cols) {
+    Grid grid;
+    grid.comm = comm;
+    MPI_Comm_rank(comm, &grid.rank);
+    grid.rows = rows;
+    grid.cols = cols;
+    grid.row = grid.rank / cols;
+    grid.col = grid.rank % cols;
+    MPI_Comm_split(comm, grid.row, grid.col, &grid.row_comm);
+    MPI_Comm_split(comm, grid.col, grid.row, &grid.col_comm);
+    return grid;
+}
+
+inline Grid make_grid(int rows, int cols) {
+    return make_grid(MPI_COMM_WORLD, rows, cols);
+}
+
+inline void free_grid(Grid& grid) {
+    MPI_Comm_free(&grid.row_comm);
+    MPI_Comm_free(&grid.col_comm);
+}
+
+// Comunicadores del modo por nodo: los procesos de un mismo nodo que están en la misma columna
+// (o fila) comparten un único bloque de columna (o de fila) en memoria compartida. Solo el líder de
+// cada grupo (rango 0) intercambia bloques con los líderes de los otros nodos.
+struct NodeGrid {
+    MPI_Comm col_group, row_group;     // mismo nodo y misma columna / fila
+    MPI_Comm col_leaders, row_leaders; // líderes de la columna / fila, uno por nodo (MPI_COMM_NULL si no es líder)
+    std::vector<int> col_block_root;   // por fila r: líder (en col_leaders) del nodo que tiene el bloque r de la columna
+    std::vector<int> row_block_root;   // por columna c: líder (en row_leaders) del nodo que tiene el bloque c de la fila
+};
+
+// Grupo del nodo, comunicador de líderes y, para cada bloque de la línea, el líder que lo aporta
+inline void make_node_line(MPI_Comm node_comm, MPI_Comm line_comm, int line, int position,
+                           MPI_Comm& group, MPI_Comm& leaders, std::vector<int>& block_root) {
+    MPI_Comm_split(node_comm, line, position, &group);
+    int group_rank;
+    MPI_Comm_rank(group, &group_rank);
+    MPI_Comm_split(line_comm, group_rank == 0 ? 0 : MPI_UNDEFINED, position, &leaders);
+
+    int leader_rank = 0, line_size;
+    if (group_rank == 0) MPI_Comm_rank(leaders, &leader_rank);
+    MPI_Bcast(&leader_rank, 1, MPI_INT, 0, group);
+    MPI_Comm_size(line_comm, &line_size);
+    block_root.resize(line_size);
+    MPI_Allgather(&leader_rank, 1, MPI_INT, block_root.data(), 1, MPI_INT, line_comm);
+}
+
+inline NodeGrid make_node_grid(const Grid& grid) {
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(grid.comm, MPI_COMM_TYPE_SHARED, grid.rank, MPI_INFO_NULL, &node_comm);
+
+    NodeGrid node;
+    make_node_line(node_comm, grid.col_comm, grid.col, grid.row, node.col_group, node.col_leaders, node.col_block_root);
+    make_node_line(node_comm, grid.row_comm, grid.row, grid.col, node.row_group, node.row_leaders, node.row_block_root);
+    MPI_Comm_free(&node_comm);
+    return node;
+}
+
+inline void free_node_grid(NodeGrid& node) {
+    MPI_Comm_free(&node.col_group);
+    MPI_Comm_free(&node.row_group);
+    if (node.col_leaders != MPI_COMM_NULL) MPI_Comm_free(&node.col_leaders);
+    if (node.row_leaders != MPI_COMM_NULL) MPI_Comm_free(&node.row_leaders);
+}
+
+// Buffer de count llaves en una ventana compartida por el grupo: lo asigna el líder y el resto
+// lo direcciona con MPI_Win_shared_query. Se mantiene una época pasiva abierta (lock_all) y las
+// escrituras se publican con sync().
+template <typename T>
+class SharedBuffer {
+public:
+    SharedBuffer(MPI_Comm group, size_t count) : group(group), count(count) {
+        int group_rank;
+        MPI_Comm_rank(group, &group_rank);
+        MPI_Aint bytes = group_rank == 0 ? static_cast<MPI_Aint>(std::max<size_t>(count, 1) * sizeof(T)) : 0;
+        MPI_Win_allocate_shared(bytes, sizeof(T), MPI_INFO_NULL, group, &ptr, &win);
+        if (group_rank != 0) {
+            MPI_Aint size;
+            int disp_unit;
+            MPI_Win_shared_query(win, 0, &size, &disp_unit, &ptr);
+        }
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    }
+
+    ~SharedBuffer() {
+        MPI_Win_unlock_all(win);
+        MPI_Win_free(&win);
+    }
+
+    SharedBuffer(const SharedBuffer&) = delete;
+    SharedBuffer& operator=(const SharedBuffer&) = delete;
+
+    // Lo escrito por cada proceso del grupo queda visible para todos
+    void sync() {
+        MPI_Win_sync(win);
+        MPI_Barrier(group);
+        MPI_Win_sync(win);
+    }
+
+    T* data() { return ptr; }
+    KeySpan<T> keys() const { return KeySpan<T>(ptr, count); }
+
+private:
+    MPI_Comm group;
+    size_t count;
+    T* ptr = nullptr;
+    MPI_Win win;
+};
+
+// Cantidades y desplazamientos de una lista de bloques puestos uno tras otro, para las colectivas "v".
+// Si el total no cabe en int (todos los bloques con n > INT_MAX) displs queda vacío: esas colectivas
+// pasan por large_count.hpp, que no usa desplazamientos en ese caso.
+inline void block_counts(const std::vector<int>& blocks, long long n, int p, std::vector<int>& counts, std::vector<int>& displs) {
+    counts.resize(blocks.size());
+    displs.resize(blocks.size());
+    long long offset = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        counts[i] = block_size(blocks[i], n, p);
+        displs[i] = static_cast<int>(std::min<long long>(offset, INT_MAX));
+        offset += counts[i];
+    }
+    if (offset > INT_MAX) displs.clear();
+}
+
+// Bloques de la columna c (c, c + cols, ...) y de la fila r (r * cols, ..., r * cols + cols - 1)
+inline std::vector<int> column_blocks(const Grid& grid, int c) {
+    std::vector<int> blocks(grid.rows);
+    for (int r = 0; r < grid.rows; ++r) blocks[r] = r * grid.cols + c;
+    return blocks;
+}
+
+inline std::vector<int> row_blocks(const Grid& grid, int r) {
+    std::vector<int> blocks(grid.cols);
+    for (int c = 0; c < grid.cols; ++c) blocks[c] = r * grid.cols + c;
+    return blocks;
+}
+
+// Tamaño total de una lista de bloques
+inline long long blocks_length(const std::vector<int>& blocks, long long n, int p) {
+    long long total = 0;
+    for (int block : blocks) total += block_size(block, n, p);
+    return total;
+}
+
+// Allgather en la columna, directo sobre column_data: cada bloque queda en un desplazamiento fijo
+// y el propio ya está en el suyo (MPI_IN_PLACE), así que la única copia es la transferencia de MPI.
+template <typename T>
+void gossip_step(const Grid& grid, std::vector<T>& column_data, const std::vector<int>& counts,
+                 const std::vector<int>& displs) {
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                   column_data.data(), counts.data(), displs.data(), mpi_type<T>::get(), grid.col_comm);
+}
+
+// Allgather en la fila: cada proceso termina con los bloques de todos los procesos de su fila.
+// Generaliza el broadcast desde la diagonal (que solo existe si rows == cols): los bloques de fila
+// y los de columna particionan los datos con cualquier factorización rows x cols.
+template <typename T>
+void reverse_broadcast_step(const Grid& grid, const T* local_block, int count, std::vector<T>& row_data,
+                            const std::vector<int>& counts, const std::vector<int>& displs) {
+    MPI_Allgatherv(local_block, count, mpi_type<T>::get(),
+                   row_data.data(), counts.data(), displs.data(), mpi_type<T>::get(), grid.row_comm);
+}
+
+// Con ranks estables (una permutación) la ubicación final es directa: out[rank - offset] = llave
+// (cada posición se escribe una sola vez, así que con pool se reparte entre hilos sin sincronizar)
+template <typename T, typename R>
+void sort_and_print_by_rank(const std::vector<R>& aggregated_ranks, const std::vector<T>& result, long long offset,
+                            ThreadPool* pool, std::vector<T>& sorted_result) {
+    sorted_result.resize(result.size());
+
+    parallel_for(pool, result.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            sorted_result[aggregated_ranks[i] - offset] = result[i];
+        }
+    }, PARALLEL_MIN_GRAIN);
+}
+
+// Índices de desempate de la columna y de la fila propias. No hace falta el índice global (que no
+// cabe en int si n pasa de 2^31): los bloques de la columna están en orden de índice global, así que
+// basta la posición en la columna, y cada llave de la fila solo se compara contra la columna. La de
+// un bloque de la fila anterior al propio va en la primera posición del bloque propio (después de
+// los bloques de columna anteriores, antes del propio), la de uno posterior justo después del bloque
+// propio, y la del bloque propio en su posición. Quedan en orden no decreciente, como pide el conteo.
+inline void tie_break_indices(const Grid& grid, long long n, std::vector<int>& column_idx, std::vector<int>& row_idx) {
+    int size = grid.rows * grid.cols;
+    column_idx.resize(blocks_length(column_blocks(grid, grid.col), n, size));
+    std::iota(column_idx.begin(), column_idx.end(), 0);
+
+    int own_begin = 0;
+    for (int k = 0; k < grid.row; ++k) own_begin += block_size(k * grid.cols + grid.col, n, size);
+    int own_count = block_size(grid.row * grid.cols + grid.col, n, size);
+    row_idx.clear();
+    for (int j = 0; j < grid.cols; ++j) {
+        int count = block_size(grid.row * grid.cols + j, n, size);
+        if (j == grid.col) {
+            for (int i = 0; i < count; ++i) row_idx.push_back(own_begin + i);
+        } else {
+            row_idx.insert(row_idx.end(), count, j < grid.col ? own_begin : own_begin + own_count);
+        }
+    }
+}
+
+// Modo de salida: Gather junta todo en el proceso 0; Distributed deja la salida repartida,
+// con el proceso i dueño de las posiciones [i*n/p, (i+1)*n/p) del arreglo ordenado.
+enum class OutputMode { Gather, Distributed };
+
+// Desde este n los ranks globales (la suma del reduce, el gather y la ubicación) van en int64_t.
+// Por debajo se quedan en int, la mitad de bytes en el reduce y el gather. Los ranks parciales y
+// los índices de desempate siguen en int: dependen del tamaño de la columna, no de n.
+const long long RANK32_MAX_N = INT_MAX;
+
+// Un vector de ranks de cada ancho; se usa el que corresponde a n (ver RANK32_MAX_N)
+struct RankVectors {
+    std::vector<int> narrow;
+    std::vector<int64_t> wide;
+
+    template <typename R>
+    std::vector<R>& get() {
+        if constexpr (std::is_same<R, int64_t>::value) return wide;
+        else return narrow;
+    }
+};
+
+struct SortOptions {
+    OutputMode output = OutputMode::Gather;
+    bool pipelined = false;   // solapa gossip/broadcast con el ordenamiento y el ranking (ver pipelined_local_ranks)
+    int chunks_per_block = 4; // tramos en que llega cada bloque de la fila en modo pipelined
+    ThreadPool* pool = nullptr; // modo híbrido: sort, ranking y ubicación locales en paralelo; MPI solo desde el hilo principal
+    const NodeGrid* node = nullptr; // modo por nodo: bloques de columna y fila en memoria compartida (ver node_grid_rank_sort)
+    bool place_keys = true;   // false: termina en el reduce, sin ubicar las llaves (argsort)
+    bool auto_kernel = true;  // false: usa kernel (Binary o Merge) en vez de la heurística de tamaños (ver autotune)
+    RankKernel kernel = RankKernel::Binary;
+    bool compress = true;     // gossip y broadcast comprimidos cuando toca el kernel de conteo (ver compressed_local_ranks)
+};
+
+// Con auto_kernel = false manda el kernel de comparación pedido; el de conteo depende del rango
+// de llaves y se mantiene cuando la heurística lo eligió
+inline void apply_kernel_option(const SortOptions& options, KernelChoice& choice) {
+    if (!options.auto_kernel && choice.kernel != RankKernel::Counting) choice.kernel = options.kernel;
+}
+
+// Buffers del reparto de pares (rank, llave) por dueño de la posición final (exchange_by_owner)
+template <typename T>
+struct ExchangeBuffers {
+    std::vector<int> dest, send_counts, recv_counts, send_displs, recv_displs, next, send_ranks, recv_ranks;
+    std::vector<T> send_keys, recv_keys;
+};
+
+/**
+ * @brief Memoria reutilizable entre ordenamientos.
+ *
+ * Guarda los buffers de columna y fila, los índices, los ranks y la salida, y los metadatos del reparto
+ * (que solo se recalculan si cambian n o la malla). Como los vectores conservan su capacidad, ordenar
+ * de nuevo con un n igual o menor no asigna memoria en la ruta por defecto (sin pipelined, sin modo
+ * por nodo y sin pool; los buffers de MPI quedan fuera de nuestro control).
+ * rank_sort además guarda aquí su malla; el workspace debe destruirse antes de MPI_Finalize.
+ */
+template <typename T>
+struct SortWorkspace {
+    // Malla propia de rank_sort, creada en el primer uso con cada comunicador
+    MPI_Comm comm = MPI_COMM_NULL;
+    Grid grid;
+
+    // Reparto para un n y una malla dados
+    long long n = -1;
+    int layout_rank = -1, layout_rows = 0, layout_cols = 0;
+    std::vector<int> counts, displs;                 // todos los bloques, en orden de proceso
+    std::vector<int> column_counts, column_displs;   // bloques de la columna propia
+    std::vector<int> row_counts, row_displs;         // bloques de la fila propia
+    std::vector<int> column_idx, row_idx;            // índices globales de origen
+
+    // Datos y ranks
+    std::vector<T> column_data, row_data;
+    std::vector<Indexed<T>> sorted_column, indexed_row;
+    std::vector<int> local_ranking;
+    RankScratch<Indexed<T>> scratch;
+
+    // Ranks globales: los del bloque propio tras el reduce y, en el proceso 0, los de todas las llaves
+    bool wide_ranks = false;
+    std::vector<int64_t> wide_ranking; // los ranks parciales en int64_t para el reduce
+    RankVectors aggregated_ranks, global_ranks;
+
+    // Gossip y broadcast comprimidos: bloques empaquetados, histogramas y tablas del kernel
+    std::vector<uint64_t> packed_column, packed_row;
+    std::vector<int> packed_column_counts, packed_column_displs, packed_row_counts, packed_row_displs;
+    std::vector<int> histograms, hist_below, rank_before, rank_after, seen;
+
+    // Salida distribuida (Alltoallv por dueño) y salida reunida en el proceso 0
+    ExchangeBuffers<T> exchange;
+    std::vector<T> all_keys;
+
+    // Entrada de rank_sort con tamaños arbitrarios por proceso
+    bool input_balanced = true;
+    std::vector<int> input_counts, input_send_counts, input_send_displs, input_recv_counts, input_recv_displs;
+
+    std::vector<T> output;
+
+    SortWorkspace() = default;
+    SortWorkspace(const SortWorkspace&) = delete;
+    SortWorkspace& operator=(const SortWorkspace&) = delete;
+
+    ~SortWorkspace() {
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (comm != MPI_COMM_NULL && !finalized) free_grid(grid);
+    }
+};
+
+// Metadatos del reparto y tamaño de los buffers; si n y la malla no cambiaron no hace nada
+template <typename T>
+void prepare_workspace(const Grid& grid, long long n, SortWorkspace<T>& ws) {
+    if (ws.n != n || ws.layout_rank != grid.rank || ws.layout_rows != grid.rows || ws.layout_cols != grid.cols) {
+        int size = grid.rows * grid.cols;
+        std::vector<int> all_blocks(size);
+        std::iota(all_blocks.begin(), all_blocks.end(), 0);
+        block_counts(all_blocks, n, size, ws.counts, ws.displs);
+        block_counts(column_blocks(grid, grid.col), n, size, ws.column_counts, ws.column_displs);
+        block_counts(row_blocks(grid, grid.row), n, size, ws.row_counts, ws.row_displs);
+        tie_break_indices(grid, n, ws.column_idx, ws.row_idx);
+
+        ws.n = n;
+        ws.wide_ranks = n > RANK32_MAX_N;
+        ws.layout_rank = grid.rank;
+        ws.layout_rows = grid.rows;
+        ws.layout_cols = grid.cols;
+    }
+    ws.column_data.resize(ws.column_idx.size());
+    ws.row_data.resize(ws.row_idx.size());
+}
+
+// Reparte pares (rank, llave) entre los procesos según el tramo de salida que le toca a cada uno
+// (destino en ex.dest); deja lo recibido en ex.recv_ranks y ex.recv_keys. El rank viaja como posición
+// dentro del bloque del dueño, que cabe en int aunque el rank global no.
+template <typename T, typename R>
+void exchange_by_owner(MPI_Comm comm, const R* ranks, const T* keys, long long n, ExchangeBuffers<T>& ex) {
+    int size;
+    MPI_Comm_size(comm, &size);
+
+    ex.send_counts.assign(size, 0);
+    ex.recv_counts.resize(size);
+    for (int d : ex.dest) ex.send_counts[d]++;
+    MPI_Alltoall(ex.send_counts.data(), 1, MPI_INT, ex.recv_counts.data(), 1, MPI_INT, comm);
+
+    ex.send_displs.assign(size, 0);
+    ex.recv_displs.assign(size, 0);
+    std::partial_sum(ex.send_counts.begin(), ex.send_counts.end() - 1, ex.send_displs.begin() + 1);
+    std::partial_sum(ex.recv_counts.begin(), ex.recv_counts.end() - 1, ex.recv_displs.begin() + 1);
+
+    // Empaquetado por destino
+    ex.send_ranks.resize(ex.dest.size());
+    ex.send_keys.resize(ex.dest.size());
+    ex.next.assign(ex.send_displs.begin(), ex.send_displs.end());
+    for (size_t i = 0; i < ex.dest.size(); ++i) {
+        int pos = ex.next[ex.dest[i]]++;
+        ex.send_ranks[pos] = static_cast<int>(ranks[i] - block_start(ex.dest[i], n, size));
+        ex.send_keys[pos] = keys[i];
+    }
+
+    int total = ex.recv_displs[size - 1] + ex.recv_counts[size - 1];
+    ex.recv_ranks.resize(total);
+    ex.recv_keys.resize(total);
+    MPI_Alltoallv(ex.send_ranks.data(), ex.send_counts.data(), ex.send_displs.data(), MPI_INT,
+                  ex.recv_ranks.data(), ex.recv_counts.data(), ex.recv_displs.data(), MPI_INT, comm);
+    MPI_Alltoallv(ex.send_keys.data(), ex.send_counts.data(), ex.send_displs.data(), mpi_type<T>::get(),
+                  ex.recv_keys.data(), ex.recv_counts.data(), ex.recv_displs.data(), mpi_type<T>::get(), comm);
+}
+
+/**
+ * @brief Envía cada llave directamente al proceso dueño de su posición final.
+ *
+ * Un Alltoallv según el rank global; como los ranks son una permutación, cada proceso recibe
+ * exactamente su tramo y lo ubica en O(n/p). El resultado queda en output: el tramo
+ * [rank*n/p, (rank+1)*n/p) del arreglo ordenado.
+ */
+template <typename T, typename R>
+void distribute_by_rank(const Grid& grid, const std::vector<R>& ranks, const T* keys, long long n, ThreadPool* pool,
+                        ExchangeBuffers<T>& ex, std::vector<T>& output) {
+    int size = grid.rows * grid.cols;
+
+    ex.dest.resize(ranks.size());
+    for (size_t i = 0; i < ranks.size(); ++i) ex.dest[i] = block_owner(ranks[i], n, size);
+
+    exchange_by_owner(grid.comm, ranks.data(), keys, n, ex);
+
+    sort_and_print_by_rank(ex.recv_ranks, ex.recv_keys, 0, pool, output);
+}
+
+// REDUCE y GATHER (o la distribución final) con ranks globales de tipo R (int o int64_t)
+template <typename R, typename Keys, typename T = typename Keys::value_type>
+void reduce_and_place(const Grid& grid, const std::vector<int>& local_ranking, const Keys& result, long long n,
+                      const SortOptions& options, SortWorkspace<T>& ws) {
+    // REDUCE (6)
+    // Suma de los ranks parciales de la fila; cada proceso de la fila se queda con un tramo
+    // del bloque de fila: el proceso de la columna c con el tramo c, que es su propio bloque
+
+    t11 = begin_phase(PHASE_REDUCE);
+    int segment = ws.row_counts[grid.col];
+    std::vector<R>& aggregated_ranks = ws.aggregated_ranks.template get<R>();
+    aggregated_ranks.resize(segment);
+    if constexpr (std::is_same<R, int>::value) {
+        MPI_Reduce_scatter(local_ranking.data(), aggregated_ranks.data(), ws.row_counts.data(), MPI_INT, MPI_SUM,
+                           grid.row_comm);
+    } else {
+        // Cada rank parcial cabe en int (es a lo más el largo de la columna), la suma no
+        ws.wide_ranking.assign(local_ranking.begin(), local_ranking.end());
+        MPI_Reduce_scatter(ws.wide_ranking.data(), aggregated_ranks.data(), ws.row_counts.data(), mpi_type<R>::get(),
+                           MPI_SUM, grid.row_comm);
+    }
+    t12 = MPI_Wtime();
+
+    if (!options.place_keys) return;
+
+    const T* own_keys = result.data() + ws.row_displs[grid.col];
+
+    if (options.output == OutputMode::Distributed) {
+        // DISTRIBUCION FINAL (7)
+        // Sin pasar por el proceso 0: cada llave va al dueño de su posición final
+
+        t15 = begin_phase(PHASE_PLACEMENT);
+        distribute_by_rank(grid, aggregated_ranks, own_keys, n, options.pool, ws.exchange, ws.output);
+        t16 = MPI_Wtime();
+        return;
+    }
+
+    // GATHER (6)
+    // El proceso 0 recibe ranks y llaves de cada bloque, en orden de rank
+
+    t13 = begin_phase(PHASE_GATHER);
+    std::vector<R>& global_ranks = ws.global_ranks.template get<R>();
+    if (grid.rank == 0) {
+        global_ranks.resize(n);
+        ws.all_keys.resize(n);
+    }
+    gatherv_large(aggregated_ranks.data(), segment, mpi_type<R>::get(), global_ranks.data(), ws.counts, ws.displs,
+                  n, 0, grid.comm);
+    gatherv_large(own_keys, segment, mpi_type<T>::get(), ws.all_keys.data(), ws.counts, ws.displs, n, 0, grid.comm);
+    t14 = MPI_Wtime();
+
+    if (grid.rank == 0) {
+        t15 = begin_phase(PHASE_PLACEMENT);
+        sort_and_print_by_rank(global_ranks, ws.all_keys, 0, options.pool, ws.output);
+        t16 = MPI_Wtime();
+    } else {
+        ws.output.clear();
+    }
+}
+
+// REDUCE y GATHER (o la distribución final) a partir de los ranks parciales del bloque de fila;
+// la salida queda en ws.output
+template <typename Keys, typename T = typename Keys::value_type>
+void reduce_and_output(const Grid& grid, const std::vector<int>& local_ranking, const Keys& result, long long n,
+                       const SortOptions& options, SortWorkspace<T>& ws) {
+    MPI_Barrier(grid.comm);
+    if (ws.wide_ranks) reduce_and_place<int64_t>(grid, local_ranking, result, n, options, ws);
+    else reduce_and_place<int>(grid, local_ranking, result, n, options, ws);
+}
+
+// starting_data y result pueden ser vectores propios o vistas (KeySpan) sobre memoria compartida del nodo
+template <typename Keys, typename Compare, typename T = typename Keys::value_type>
+void calculate_and_print_ranks(const Grid& grid, const Keys& starting_data, const Keys& result, long long n,
+                               Compare comp, const SortOptions& options, SortWorkspace<T>& ws) {
+    KernelChoice choice = choose_rank_kernel(starting_data, result, comp);
+    apply_kernel_option(options, choice);
+    IndexedCompare<Compare> indexed_comp{comp};
+
+    //SORT (4)
+    // El kernel de conteo no necesita la columna ordenada
+
+    t7 = begin_phase(PHASE_SORT);
+    if (choice.kernel != RankKernel::Counting) {
+        // Índices globales de origen para desempatar llaves iguales
+        with_indices(starting_data, ws.column_idx, ws.sorted_column);
+        parallel_sort(options.pool, ws.sorted_column, indexed_comp);
+    }
+    t8 = MPI_Wtime();
+
+    // LOCAL RANKING (5)
+
+    t9 = begin_phase(PHASE_RANK);
+    bool counted = false;
+    // El kernel de conteo solo se instancia para enteros con orden natural (no para registros)
+    if constexpr (counting_applicable<T, Compare>()) {
+        if (choice.kernel == RankKernel::Counting) {
+            local_rank_counting(options.pool, starting_data, ws.column_idx, result, ws.row_idx, choice.lo, choice.span,
+                                ws.local_ranking, ws.scratch.counting);
+            counted = true;
+        }
+    }
+    if (!counted) {
+        with_indices(result, ws.row_idx, ws.indexed_row);
+        local_rank(options.pool, choice, ws.sorted_column, ws.indexed_row, indexed_comp, ws.local_ranking, ws.scratch);
+    }
+    t10 = MPI_Wtime();
+
+    reduce_and_output(grid, ws.local_ranking, result, n, options, ws);
+}
+
+// Rango global de llaves [lo, hi] en un solo Allreduce: se lleva a enteros sin signo que conservan
+// el orden (bit de signo invertido) y se reduce {~lo, hi} con MPI_MAX. Decide el formato y el kernel
+// del gossip, así que su comunicación se cuenta en esa fase.
+template <typename T>
+void global_key_range(MPI_Comm comm, const T* keys, int count, T& lo, T& hi) {
+    current_phase = PHASE_GOSSIP;
+    const uint64_t bias = std::is_signed<T>::value ? uint64_t(1) << 63 : 0;
+    auto to_ordered = [&](T x) { return static_cast<uint64_t>(static_cast<int64_t>(x)) ^ bias; };
+
+    uint64_t range[2] = {0, 0};
+    if (count > 0) {
+        auto [lo_it, hi_it] = std::minmax_element(keys, keys + count);
+        range[0] = ~to_ordered(*lo_it);
+        range[1] = to_ordered(*hi_it);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, range, 2, MPI_UINT64_T, MPI_MAX, comm);
+    lo = static_cast<T>(~range[0] ^ bias);
+    hi = static_cast<T>(range[1] ^ bias);
+}
+
+/**
+ * @brief Gossip, broadcast, sort y ranking solapados (modo pipelined).
+ *
+ * El gossip se lanza con MPI_Iallgatherv y, mientras corre, se ordena el bloque propio. El bloque
+ * de fila llega en chunks_per_block tramos por dueño (un MPI_Ibcast por tramo) y cada tramo se
+ * rankea contra la columna ordenada apenas llega. Los tramos se esperan en orden de índice global,
+ * que es lo que necesita el kernel de conteo para seguir su recorrido entre tramos.
+ * Deja los ranks parciales en ws.local_ranking. Los tramos y los pedidos no bloqueantes usan
+ * memoria propia de cada llamada; la garantía de no asignar es para la ruta por defecto.
+ */
+template <typename T, typename Compare>
+void pipelined_local_ranks(const Grid& grid, SortWorkspace<T>& ws, Compare comp, const SortOptions& options) {
+    std::vector<T>& column_data = ws.column_data;
+    std::vector<T>& row_data = ws.row_data;
+    const std::vector<int>& column_counts = ws.column_counts;
+    const std::vector<int>& column_displs = ws.column_displs;
+    const std::vector<int>& row_counts = ws.row_counts;
+    const std::vector<int>& row_displs = ws.row_displs;
+    const T* local_block = column_data.data() + column_displs[grid.row];
+    int local_count = column_counts[grid.row];
+
+    std::copy(local_block, local_block + local_count, row_data.begin() + row_displs[grid.col]);
+
+    // El kernel se elige antes de tener la fila: el rango de llaves se reduce entre todos
+    KernelChoice choice;
+    if constexpr (counting_applicable<T, Compare>()) {
+        T lo, hi;
+        global_key_range(grid.comm, local_block, local_count, lo, hi);
+        choice = choose_rank_kernel(lo, hi, column_data.size(), row_data.size(), comp);
+    }
+
+    // GOSSIP (2) y BROADCAST (3), no bloqueantes
+
+    MPI_Request gossip_request;
+    t3 = begin_phase(PHASE_GOSSIP);
+    MPI_Iallgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, column_data.data(), column_counts.data(), column_displs.data(),
+                    mpi_type<T>::get(), grid.col_comm, &gossip_request);
+
+    std::vector<MPI_Request> chunk_requests;
+    std::vector<int> chunk_offsets, chunk_lengths;
+    t5 = begin_phase(PHASE_BROADCAST);
+    for (int c = 0; c < grid.cols; ++c) {
+        for (int k = 0; k < options.chunks_per_block; ++k) {
+            int begin = row_displs[c] + static_cast<long long>(row_counts[c]) * k / options.chunks_per_block;
+            int end = row_displs[c] + static_cast<long long>(row_counts[c]) * (k + 1) / options.chunks_per_block;
+            if (begin == end) continue;
+
+            chunk_requests.emplace_back();
+            chunk_offsets.push_back(begin);
+            chunk_lengths.push_back(end - begin);
+            MPI_Ibcast(row_data.data() + begin, end - begin, mpi_type<T>::get(), c, grid.row_comm, &chunk_requests.back());
+        }
+    }
+
+    const std::vector<int>& column_idx = ws.column_idx;
+    const std::vector<int>& row_idx = ws.row_idx;
+    IndexedCompare<Compare> indexed_comp{comp};
+    std::vector<Indexed<T>>& sorted_column = ws.sorted_column;
+    double sort_time = 0, rank_time = 0;
+
+    //SORT (4)
+    // El bloque propio se ordena mientras corre el gossip; el resto al llegar, y luego se mezclan
+
+    t7 = begin_phase(PHASE_SORT);
+    if (choice.kernel != RankKernel::Counting) {
+        int own_begin = column_displs[grid.row];
+        std::vector<Indexed<T>> own(local_count);
+        for (int i = 0; i < local_count; ++i) own[i] = {local_block[i], column_idx[own_begin + i]};
+        parallel_sort(options.pool, own, indexed_comp);
+        sort_time += MPI_Wtime() - t7;
+
+        MPI_Wait(&gossip_request, MPI_STATUS_IGNORE);
+        t4 = MPI_Wtime();
+
+        std::vector<Indexed<T>> others;
+        others.reserve(column_data.size() - local_count);
+        for (int i = 0; i < own_begin; ++i) others.emplace_back(column_data[i], column_idx[i]);
+        for (size_t i = own_begin + local_count; i < column_data.size(); ++i) others.emplace_back(column_data[i], column_idx[i]);
+        parallel_sort(options.pool, others, indexed_comp);
+        sorted_column.resize(column_data.size());
+        std::merge(own.begin(), own.end(), others.begin(), others.end(), sorted_column.begin(), indexed_comp);
+        sort_time += MPI_Wtime() - t4;
+    } else {
+        MPI_Wait(&gossip_request, MPI_STATUS_IGNORE);
+        t4 = MPI_Wtime();
+    }
+    t8 = t7 + sort_time;
+
+    // LOCAL RANKING (5)
+    // Cada tramo de la fila se rankea apenas llega
+
+    std::vector<int>& local_ranking = ws.local_ranking;
+    local_ranking.resize(row_data.size());
+    std::unique_ptr<CountingRanker<T>> counting;
+    if constexpr (counting_applicable<T, Compare>()) {
+        if (choice.kernel == RankKernel::Counting) {
+            counting = std::make_unique<CountingRanker<T>>(column_data, column_idx, choice.lo, choice.span);
+        }
+    }
+
+    t9 = begin_phase(PHASE_RANK);
+    for (size_t k = 0; k < chunk_requests.size(); ++k) {
+        MPI_Wait(&chunk_requests[k], MPI_STATUS_IGNORE);
+        t6 = MPI_Wtime();
+
+        int begin = chunk_offsets[k], length = chunk_lengths[k];
+        bool counted = false;
+        if constexpr (counting_applicable<T, Compare>()) {
+            if (counting) {
+                counting->rank(row_data.data() + begin, row_idx.data() + begin, length, local_ranking.data() + begin);
+                counted = true;
+            }
+        }
+        if (!counted) {
+            std::vector<Indexed<T>> chunk(length);
+            for (int i = 0; i < length; ++i) chunk[i] = {row_data[begin + i], row_idx[begin + i]};
+            KernelChoice chunk_choice;
+            chunk_choice.kernel = sorted_rank_kernel(sorted_column.size(), length);
+            apply_kernel_option(options, chunk_choice);
+            std::vector<int> chunk_ranks = local_rank(options.pool, chunk_choice, sorted_column, chunk, indexed_comp);
+            std::copy(chunk_ranks.begin(), chunk_ranks.end(), local_ranking.begin() + begin);
+        }
+        rank_time += MPI_Wtime() - t6;
+    }
+    if (chunk_requests.empty()) t6 = MPI_Wtime();
+    t10 = t9 + rank_time;
+}
+
+// Cantidades y desplazamientos, en palabras, de bloques empaquetados a bits bits por llave
+inline void packed_counts(const std::vector<int>& counts, int bits, std::vector<int>& word_counts,
+                          std::vector<int>& word_displs) {
+    word_counts.resize(counts.size());
+    word_displs.assign(counts.size(), 0);
+    for (size_t b = 0; b < counts.size(); ++b) word_counts[b] = static_cast<int>(packed_words(counts[b], bits));
+    std::partial_sum(word_counts.begin(), word_counts.end() - 1, word_displs.begin() + 1);
+}
+
+/**
+ * @brief Gossip y broadcast comprimidos, con el ranking leyendo el formato recibido (options.compress).
+ *
+ * Con llaves de rango chico (kernel de conteo) la fila viaja empaquetada a bits_for_span(span) bits
+ * por llave. La columna, que el kernel solo usa como cantidades por valor, viaja como un histograma
+ * por bloque si ocupa menos que el bloque empaquetado más chico; si no, empaquetada, y se cuenta al
+ * recibirla. Ningún proceso reconstruye las llaves de los otros bloques: el ranking lee la fila
+ * empaquetada (local_rank_packed). Deja los ranks parciales en ws.local_ranking y el bloque propio
+ * en su lugar de ws.row_data, que es lo que usan el reduce y la salida.
+ */
+template <typename T>
+void compressed_local_ranks(const Grid& grid, long long n, SortWorkspace<T>& ws, const KernelChoice& choice,
+                            const SortOptions& options) {
+    int size = grid.rows * grid.cols;
+    const T* local_block = ws.column_data.data() + ws.column_displs[grid.row];
+    int local_count = ws.column_counts[grid.row];
+    uint64_t lo = choice.lo;
+    int span = static_cast<int>(choice.span);
+    int bits = bits_for_span(choice.span);
+    bool histogram_gossip = span * sizeof(int) <= packed_words(n / size, bits) * sizeof(uint64_t);
+
+    // Todos empaquetan igual, así que el bloque propio empaquetado sirve para la columna y la fila
+    // (con histogramas en la columna se empaqueta recién para el broadcast)
+    packed_counts(ws.row_counts, bits, ws.packed_row_counts, ws.packed_row_displs);
+    ws.packed_row.resize(ws.packed_row_displs.back() + ws.packed_row_counts.back());
+    uint64_t* own_words = ws.packed_row.data() + ws.packed_row_displs[grid.col];
+
+    // GOSSIP (2)
+
+    t3 = begin_phase(PHASE_GOSSIP);
+    if (histogram_gossip) {
+        ws.histograms.assign(static_cast<size_t>(grid.rows) * span, 0);
+        add_histogram(local_block, local_count, lo, ws.histograms.data() + static_cast<size_t>(grid.row) * span);
+        MPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, ws.histograms.data(), span, MPI_INT, grid.col_comm);
+    } else {
+        pack_keys(local_block, local_count, lo, bits, own_words);
+        packed_counts(ws.column_counts, bits, ws.packed_column_counts, ws.packed_column_displs);
+        ws.packed_column.resize(ws.packed_column_displs.back() + ws.packed_column_counts.back());
+        std::copy(own_words, own_words + ws.packed_column_counts[grid.row],
+                  ws.packed_column.begin() + ws.packed_column_displs[grid.row]);
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, ws.packed_column.data(), ws.packed_column_counts.data(),
+                       ws.packed_column_displs.data(), MPI_UINT64_T, grid.col_comm);
+    }
+    t4 = MPI_Wtime();
+
+    // BROADCAST (3)
+
+    t5 = begin_phase(PHASE_BROADCAST);
+    if (histogram_gossip) pack_keys(local_block, local_count, lo, bits, own_words);
+    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, ws.packed_row.data(), ws.packed_row_counts.data(),
+                   ws.packed_row_displs.data(), MPI_UINT64_T, grid.row_comm);
+    std::copy(local_block, local_block + local_count, ws.row_data.begin() + ws.row_displs[grid.col]);
+    t6 = MPI_Wtime();
+
+    //SORT (4): el kernel de conteo no ordena la columna
+
+    t7 = t8 = begin_phase(PHASE_SORT);
+
+    // LOCAL RANKING (5)
+    // Por valor: total de la columna, iguales en los bloques de columna anteriores al propio e iguales
+    // en el propio; de ahí las tablas before y after de local_rank_packed
+
+    t9 = begin_phase(PHASE_RANK);
+    std::vector<int>& total = ws.rank_before;
+    std::vector<int>& own = ws.rank_after;
+    total.assign(span, 0);
+    own.assign(span, 0);
+    ws.hist_below.assign(span, 0);
+    if (!histogram_gossip) ws.histograms.resize(span);
+    for (int k = 0; k < grid.rows; ++k) {
+        const int* hist = ws.histograms.data();
+        if (histogram_gossip) {
+            hist += static_cast<size_t>(k) * span;
+        } else {
+            std::fill(ws.histograms.begin(), ws.histograms.end(), 0);
+            add_packed_histogram(ws.packed_column.data() + ws.packed_column_displs[k], ws.column_counts[k], bits,
+                                 ws.histograms.data());
+        }
+        for (int v = 0; v < span; ++v) {
+            total[v] += hist[v];
+            if (k < grid.row) ws.hist_below[v] += hist[v];
+            if (k == grid.row) own[v] = hist[v];
+        }
+    }
+    int smaller = 0;
+    for (int v = 0; v < span; ++v) {
+        int count = total[v];
+        ws.rank_before[v] = smaller + ws.hist_below[v];
+        ws.rank_after[v] = ws.rank_before[v] + own[v];
+        smaller += count;
+    }
+    local_rank_packed(options.pool, ws.rank_before, ws.rank_after, local_block, lo, grid.col, ws.packed_row.data(),
+                      ws.packed_row_displs, ws.row_counts, ws.row_displs, bits, ws.seen, ws.local_ranking);
+    t10 = MPI_Wtime();
+}
+
+// Completa los bloques de una línea (columna o fila) entre los líderes de cada nodo: un MPI_Ibcast
+// por bloque desde el líder del nodo que lo tiene. Dentro del nodo no hay mensajes.
+template <typename T>
+void leaders_exchange(MPI_Comm leaders, const std::vector<int>& block_root, T* data,
+                      const std::vector<int>& counts, const std::vector<int>& displs) {
+    if (leaders == MPI_COMM_NULL) return;
+    int leaders_size;
+    MPI_Comm_size(leaders, &leaders_size);
+    if (leaders_size == 1) return;
+
+    std::vector<MPI_Request> requests(counts.size());
+    for (size_t b = 0; b < counts.size(); ++b) {
+        MPI_Ibcast(data + displs[b], counts[b], mpi_type<T>::get(), block_root[b], leaders, &requests[b]);
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+}
+
+// SORT y LOCAL RANKING del modo por nodo. Los procesos de un grupo de columna tienen la misma
+// columna (y los mismos índices de desempate), así que la columna ordenada se arma una sola vez por
+// grupo en una ventana compartida: cada proceso ordena un tramo y los tramos se mezclan de a pares.
+// La fila se rankea en su lugar con lower_bound sobre esa columna, sin pares privados; por eso en
+// este modo el kernel de mezcla se reemplaza por el binario.
+template <typename T, typename Compare>
+void node_local_ranks(const NodeGrid& node, KeySpan<T> column, KeySpan<T> row, Compare comp,
+                      const SortOptions& options, SortWorkspace<T>& ws) {
+    KernelChoice choice = choose_rank_kernel(column, row, comp);
+    apply_kernel_option(options, choice);
+    IndexedCompare<Compare> indexed_comp{comp};
+
+    // La ventana es colectiva en el grupo: se arma si algún proceso del grupo no usa el conteo
+    int needs_sorted = choice.kernel != RankKernel::Counting;
+    MPI_Allreduce(MPI_IN_PLACE, &needs_sorted, 1, MPI_INT, MPI_MAX, node.col_group);
+
+    //SORT (4)
+
+    t7 = begin_phase(PHASE_SORT);
+    std::unique_ptr<SharedBuffer<Indexed<T>>> sorted;
+    if (needs_sorted) {
+        sorted = std::make_unique<SharedBuffer<Indexed<T>>>(node.col_group, column.size());
+        int group_rank, group_size;
+        MPI_Comm_rank(node.col_group, &group_rank);
+        MPI_Comm_size(node.col_group, &group_size);
+        auto bound = [&](int k) { return column.size() * k / group_size; };
+        Indexed<T>* pairs = sorted->data();
+
+        for (size_t i = bound(group_rank); i < bound(group_rank + 1); ++i) pairs[i] = {column[i], ws.column_idx[i]};
+        std::sort(pairs + bound(group_rank), pairs + bound(group_rank + 1), indexed_comp);
+        sorted->sync();
+        for (int width = 1; width < group_size; width *= 2) {
+            if (group_rank % (2 * width) == 0 && group_rank + width < group_size) {
+                std::inplace_merge(pairs + bound(group_rank), pairs + bound(group_rank + width),
+                                   pairs + bound(std::min(group_rank + 2 * width, group_size)), indexed_comp);
+            }
+            sorted->sync();
+        }
+    }
+    t8 = MPI_Wtime();
+
+    // LOCAL RANKING (5)
+
+    t9 = begin_phase(PHASE_RANK);
+    bool counted = false;
+    if constexpr (counting_applicable<T, Compare>()) {
+        if (choice.kernel == RankKernel::Counting) {
+            local_rank_counting(options.pool, column, ws.column_idx, row, ws.row_idx, choice.lo, choice.span,
+                                ws.local_ranking, ws.scratch.counting);
+            counted = true;
+        }
+    }
+    if (!counted) {
+        KeySpan<Indexed<T>> sorted_column = sorted->keys();
+        ws.local_ranking.resize(row.size());
+        parallel_for(options.pool, row.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                Indexed<T> key{row[i], ws.row_idx[i]};
+                ws.local_ranking[i] = static_cast<int>(
+                    std::lower_bound(sorted_column.begin(), sorted_column.end(), key, indexed_comp) - sorted_column.begin());
+            }
+        }, PARALLEL_MIN_GRAIN);
+    }
+    t10 = MPI_Wtime();
+}
+
+/**
+ * @brief Variante por nodo del ordenamiento (options.node).
+ *
+ * Cada nodo guarda una sola copia de cada bloque de columna y de fila que usan sus procesos, en
+ * ventanas MPI_Win_allocate_shared. El bloque propio se escribe directo en la columna compartida,
+ * y el gossip y el broadcast solo mueven entre nodos los bloques que faltan (entre líderes); el resto
+ * de los procesos lee las ventanas en su lugar. La columna ordenada también es una por grupo y la
+ * fila se rankea en su lugar (ver node_local_ranks). No se combina con el modo pipelined.
+ */
+template <typename T, typename Compare, typename PlaceBlock>
+void node_grid_rank_sort(const Grid& grid, long long n, Compare comp, const SortOptions& options,
+                         SortWorkspace<T>& ws, PlaceBlock place_block) {
+    const NodeGrid& node = *options.node;
+    SharedBuffer<T> column(node.col_group, ws.column_idx.size());
+    SharedBuffer<T> row(node.row_group, ws.row_idx.size());
+    T* local_block = column.data() + ws.column_displs[grid.row];
+    int local_count = ws.column_counts[grid.row];
+
+    //SCATTER (1)
+
+    t1 = begin_phase(PHASE_SCATTER);
+    place_block(local_block, local_count);
+    t2 = MPI_Wtime();
+
+    // GOSSIP (2)
+    // Los bloques del nodo ya están en la columna compartida; entre nodos los intercambian los líderes
+
+    t3 = begin_phase(PHASE_GOSSIP);
+    column.sync();
+    leaders_exchange(node.col_leaders, node.col_block_root, column.data(), ws.column_counts, ws.column_displs);
+    column.sync();
+    t4 = MPI_Wtime();
+
+    // BROADCAST (3)
+    // Cada proceso copia su bloque a la fila compartida, y los líderes completan los de otros nodos
+
+    t5 = begin_phase(PHASE_BROADCAST);
+    std::copy(local_block, local_block + local_count, row.data() + ws.row_displs[grid.col]);
+    row.sync();
+    leaders_exchange(node.row_leaders, node.row_block_root, row.data(), ws.row_counts, ws.row_displs);
+    row.sync();
+    t6 = MPI_Wtime();
+
+    // SORT y LOCAL RANKING, leyendo la columna y la fila en su lugar; REDUCE Y GATHER
+    node_local_ranks(node, column.keys(), row.keys(), comp, options, ws);
+    reduce_and_output(grid, ws.local_ranking, row.keys(), n, options, ws);
+}
+
+// Todas las fases a partir del bloque propio. place_block(local_block, local_count) lo deja en su
+// lugar dentro de la columna (scatter desde el proceso 0 o rebalanceo de la entrada de rank_sort).
+template <typename T, typename Compare, typename PlaceBlock>
+void sort_placed_blocks(const Grid& grid, long long n, Compare comp, const SortOptions& options,
+                        SortWorkspace<T>& ws, PlaceBlock place_block) {
+    reset_phase_timers();
+    prepare_workspace(grid, n, ws);
+    // El modo por nodo no se combina con el pipelined: con options.node, options.pipelined se ignora
+    // (main.cpp rechaza la combinación)
+    if (options.node) {
+        node_grid_rank_sort(grid, n, comp, options, ws, place_block);
+        return;
+    }
+
+    // Buffers contiguos de columna y de fila: el bloque propio se recibe directo en su lugar
+    // dentro de la columna
+    T* local_block = ws.column_data.data() + ws.column_displs[grid.row];
+    int local_count = ws.column_counts[grid.row];
+
+    //SCATTER (1)
+
+    t1 = begin_phase(PHASE_SCATTER);
+    place_block(local_block, local_count);
+    t2 = MPI_Wtime();
+
+    if (options.pipelined) {
+        pipelined_local_ranks(grid, ws, comp, options);
+        reduce_and_output(grid, ws.local_ranking, ws.row_data, n, options, ws);
+        return;
+    }
+
+    // Con el kernel de conteo gossip y broadcast van comprimidos. Cambia el formato de las colectivas,
+    // así que la decisión es la misma en todos: rango global de llaves y tamaños medios de columna y fila
+    if constexpr (counting_applicable<T, Compare>()) {
+        if (options.compress) {
+            T lo, hi;
+            global_key_range(grid.comm, local_block, local_count, lo, hi);
+            KernelChoice choice = choose_rank_kernel(lo, hi, n / grid.cols, n / grid.rows, comp);
+            apply_kernel_option(options, choice);
+            if (choice.kernel == RankKernel::Counting) {
+                compressed_local_ranks(grid, n, ws, choice, options);
+                reduce_and_output(grid, ws.local_ranking, ws.row_data, n, options, ws);
+                return;
+            }
+        }
+    }
+
+    // GOSSIP (2)
+
+    t3 = begin_phase(PHASE_GOSSIP);
+    gossip_step(grid, ws.column_data, ws.column_counts, ws.column_displs);
+    t4 = MPI_Wtime();
+
+    // BROADCAST (3)
+    // Allgather en la fila: el bloque propio se lee desde su lugar en la columna
+
+    t5 = begin_phase(PHASE_BROADCAST);
+    reverse_broadcast_step(grid, local_block, local_count, ws.row_data, ws.row_counts, ws.row_displs);
+    t6 = MPI_Wtime();
+
+    // SORT, LOCAL, RANKING, REDUCE Y GATHER
+    calculate_and_print_ranks(grid, ws.column_data, ws.row_data, n, comp, options, ws);
+}
+
+/**
+ * @brief Ordena por ranking en una malla rows x cols de procesos.
+ *
+ * El proceso 0 aporta la entrada completa, de cualquier largo n: el bloque i es [i*n/p, (i+1)*n/p).
+ * Con OutputMode::Gather recibe la salida ordenada y en el resto de procesos el resultado es vacío;
+ * con OutputMode::Distributed cada proceso i devuelve las posiciones [i*n/p, (i+1)*n/p) de la salida.
+ *
+ * @param comp Orden estricto débil sobre las llaves (por defecto std::less<T>).
+ * @param options Modo de salida, de solapamiento, pool de hilos (modo híbrido) y comunicadores por nodo.
+ */
+template <typename T, typename Compare = std::less<T>>
+std::vector<T> grid_rank_sort(const Grid& grid, const std::vector<T>& input, Compare comp = Compare(),
+                              const SortOptions& options = SortOptions()) {
+    long long n = input.size();
+    MPI_Bcast(&n, 1, MPI_LONG_LONG, 0, grid.comm);
+
+    SortWorkspace<T> ws;
+    sort_placed_blocks(grid, n, comp, options, ws, [&](T* local_block, int local_count) {
+        scatterv_large(input.data(), ws.counts, ws.displs, mpi_type<T>::get(), local_block, local_count, n, 0,
+                       grid.comm);
+    });
+    current_phase = PHASE_OTHER;
+    return std::move(ws.output);
+}
+
+// Lleva la entrada de rank_sort (cualquier cantidad por proceso) al bloque balanceado propio. Las
+// posiciones globales de cada entrada son contiguas, así que lo que va a cada dueño también lo es
+// y alcanza un Alltoallv; si cada proceso ya trae su bloque, es una copia local.
+template <typename T>
+void rebalance_input(const Grid& grid, KeySpan<T> local_input, long long n, SortWorkspace<T>& ws,
+                     T* local_block, int local_count) {
+    int size = grid.rows * grid.cols;
+    bool balanced = true;
+    for (int i = 0; i < size; ++i) balanced = balanced && ws.input_counts[i] == block_size(i, n, size);
+    ws.input_balanced = balanced;
+    if (balanced) {
+        std::copy(local_input.begin(), local_input.end(), local_block);
+        return;
+    }
+
+    // Intersección de [offset_i, offset_i + input_counts[i]) con cada bloque [block_start(d), block_start(d + 1))
+    auto overlap = [](long long a0, long long a1, long long b0, long long b1) {
+        return static_cast<int>(std::max(0LL, std::min(a1, b1) - std::max(a0, b0)));
+    };
+    ws.input_send_counts.resize(size);
+    ws.input_recv_counts.resize(size);
+    ws.input_send_displs.assign(size, 0);
+    ws.input_recv_displs.assign(size, 0);
+    long long my_offset = 0, offset = 0;
+    for (int i = 0; i < grid.rank; ++i) my_offset += ws.input_counts[i];
+    long long my_first = block_start(grid.rank, n, size), my_last = my_first + local_count;
+    for (int i = 0; i < size; ++i) {
+        ws.input_send_counts[i] = overlap(my_offset, my_offset + local_input.size(), block_start(i, n, size),
+                                          block_start(i + 1, n, size));
+        ws.input_recv_counts[i] = overlap(offset, offset + ws.input_counts[i], my_first, my_last);
+        offset += ws.input_counts[i];
+    }
+    std::partial_sum(ws.input_send_counts.begin(), ws.input_send_counts.end() - 1, ws.input_send_displs.begin() + 1);
+    std::partial_sum(ws.input_recv_counts.begin(), ws.input_recv_counts.end() - 1, ws.input_recv_displs.begin() + 1);
+
+    MPI_Alltoallv(local_input.data(), ws.input_send_counts.data(), ws.input_send_displs.data(), mpi_type<T>::get(),
+                  local_block, ws.input_recv_counts.data(), ws.input_recv_displs.data(), mpi_type<T>::get(), grid.comm);
+}
+
+/**
+ * @brief Punto de entrada de la biblioteca: ordena una entrada repartida entre los procesos de la malla.
+ *
+ * Cada proceso aporta local_input (cualquier cantidad, posiblemente cero); la entrada global es la
+ * concatenación en orden de proceso. Todos los buffers quedan en ws, así que llamadas repetidas con
+ * tamaños parecidos no asignan memoria.
+ *
+ * @param options Como en grid_rank_sort; con OutputMode::Distributed el proceso i recibe las
+ *                posiciones [i*n/p, (i+1)*n/p) de la salida.
+ * @return Vista sobre la salida local, válida hasta la siguiente llamada con el mismo ws.
+ */
+template <typename T, typename Compare = std::less<T>>
+KeySpan<T> rank_sort(const Grid& grid, KeySpan<T> local_input, SortWorkspace<T>& ws, Compare comp = Compare(),
+                     const SortOptions& options = SortOptions()) {
+    int size = grid.rows * grid.cols;
+
+    // Tamaño de la entrada de cada proceso: n y los desplazamientos globales
+    int local_size = static_cast<int>(local_input.size());
+    ws.input_counts.resize(size);
+    MPI_Allgather(&local_size, 1, MPI_INT, ws.input_counts.data(), 1, MPI_INT, grid.comm);
+    long long n = 0;
+    for (int count : ws.input_counts) n += count;
+
+    sort_placed_blocks(grid, n, comp, options, ws, [&](T* local_block, int local_count) {
+        rebalance_input(grid, local_input, n, ws, local_block, local_count);
+    });
+    current_phase = PHASE_OTHER;
+    return KeySpan<T>(ws.output);
+}
+
+// Igual, pero la malla se arma una sola vez por comunicador y queda guardada en ws.
+// options.node no se usa aquí: necesita comunicadores de la misma malla (usar la versión con Grid).
+template <typename T, typename Compare = std::less<T>>
+KeySpan<T> rank_sort(MPI_Comm comm, KeySpan<T> local_input, SortWorkspace<T>& ws, Compare comp = Compare(),
+                     SortOptions options = SortOptions()) {
+    if (ws.comm != comm) {
+        if (ws.comm != MPI_COMM_NULL) free_grid(ws.grid);
+        int size, rows, cols;
+        MPI_Comm_size(comm, &size);
+        choose_grid_shape(size, rows, cols);
+        ws.grid = make_grid(comm, rows, cols);
+        ws.comm = comm;
+        ws.n = -1;
+    }
+    options.node = nullptr;
+    return rank_sort(ws.grid, local_input, ws, comp, options);
+}
+
+// Memoria reutilizable para los payloads (modo llave-valor y argsort)
+template <typename V>
+struct ValueWorkspace {
+    RankVectors ranks;        // rank global de cada valor, en el proceso que lo tiene
+    RankVectors all_ranks;    // con OutputMode::Gather, los de todos los valores en el proceso 0
+    std::vector<V> values;    // valores generados (índices de argsort)
+    ExchangeBuffers<V> exchange;
+    std::vector<V> output;
+};
+
+// Lleva los ranks del bloque propio (ws.aggregated_ranks) a los procesos que aportaron cada llave:
+// si la entrada vino rebalanceada, es el Alltoallv inverso del rebalanceo (solo enteros).
+template <typename R, typename T>
+void ranks_to_holders(const Grid& grid, SortWorkspace<T>& ws, std::vector<R>& ranks) {
+    current_phase = PHASE_PLACEMENT;
+    std::vector<R>& aggregated_ranks = ws.aggregated_ranks.template get<R>();
+    if (ws.input_balanced) {
+        ranks.assign(aggregated_ranks.begin(), aggregated_ranks.end());
+        return;
+    }
+    int local_size = ws.input_counts[grid.rank];
+    ranks.resize(local_size);
+    MPI_Alltoallv(aggregated_ranks.data(), ws.input_recv_counts.data(), ws.input_recv_displs.data(),
+                  mpi_type<R>::get(), ranks.data(), ws.input_send_counts.data(), ws.input_send_displs.data(),
+                  mpi_type<R>::get(), grid.comm);
+}
+
+// Cada valor viaja una sola vez: desde el proceso que lo tiene hasta el dueño de su posición final
+// (el proceso 0 con OutputMode::Gather). Se manda junto a su rank, sin pasar por gossip ni broadcast.
+template <typename R, typename V>
+void place_values(const Grid& grid, const std::vector<R>& ranks, const V* values, long long n,
+                  const SortOptions& options, ValueWorkspace<V>& vws) {
+    current_phase = PHASE_PLACEMENT;
+    if (options.output == OutputMode::Distributed) {
+        distribute_by_rank(grid, ranks, values, n, options.pool, vws.exchange, vws.output);
+        return;
+    }
+    // Todo va al proceso 0, en orden de proceso: cuántos trae cada uno y un gather de ranks y valores
+    int size = grid.rows * grid.cols;
+    ExchangeBuffers<V>& ex = vws.exchange;
+    int count = static_cast<int>(ranks.size());
+    ex.recv_counts.resize(size);
+    ex.recv_displs.assign(size, 0);
+    MPI_Gather(&count, 1, MPI_INT, ex.recv_counts.data(), 1, MPI_INT, 0, grid.comm);
+    if (fits_int_count(n)) std::partial_sum(ex.recv_counts.begin(), ex.recv_counts.end() - 1, ex.recv_displs.begin() + 1);
+
+    std::vector<R>& all_ranks = vws.all_ranks.template get<R>();
+    all_ranks.resize(grid.rank == 0 ? n : 0);
+    ex.recv_keys.resize(grid.rank == 0 ? n : 0);
+    gatherv_large(ranks.data(), count, mpi_type<R>::get(), all_ranks.data(), ex.recv_counts, ex.recv_displs, n, 0,
+                  grid.comm);
+    gatherv_large(values, count, mpi_type<V>::get(), ex.recv_keys.data(), ex.recv_counts, ex.recv_displs, n, 0,
+                  grid.comm);
+    if (grid.rank == 0) sort_and_print_by_rank(all_ranks, ex.recv_keys, 0, options.pool, vws.output);
+    else vws.output.clear();
+}
+
+// Ubicación de los valores con ranks de tipo R (ver rank_sort_by_key)
+template <typename R, typename T, typename V>
+void place_by_key(const Grid& grid, SortWorkspace<T>& ws, const V* values, const SortOptions& options,
+                  ValueWorkspace<V>& vws) {
+    std::vector<R>& ranks = vws.ranks.template get<R>();
+    ranks_to_holders(grid, ws, ranks);
+    place_values(grid, ranks, values, ws.n, options, vws);
+}
+
+/**
+ * @brief Ordena llaves con payload: cada llave local_keys[i] lleva local_values[i].
+ *
+ * Las llaves siguen el camino de rank_sort; los valores se quedan en su proceso hasta la ubicación
+ * final, cuando cada uno viaja una sola vez al dueño de su posición, así que el gossip y el broadcast
+ * no crecen con el ancho del registro. Los valores ordenados quedan en sorted_values (vista sobre vws).
+ *
+ * @return Vista sobre las llaves ordenadas locales, como rank_sort.
+ */
+template <typename T, typename V, typename Compare = std::less<T>>
+KeySpan<T> rank_sort_by_key(const Grid& grid, KeySpan<T> local_keys, KeySpan<V> local_values, SortWorkspace<T>& ws,
+                            ValueWorkspace<V>& vws, KeySpan<V>& sorted_values, Compare comp = Compare(),
+                            const SortOptions& options = SortOptions()) {
+    KeySpan<T> sorted_keys = rank_sort(grid, local_keys, ws, comp, options);
+
+    if (ws.wide_ranks) place_by_key<int64_t>(grid, ws, local_values.data(), options, vws);
+    else place_by_key<int>(grid, ws, local_values.data(), options, vws);
+    current_phase = PHASE_OTHER;
+    sorted_values = KeySpan<V>(vws.output);
+    return sorted_keys;
+}
+
+/**
+ * @brief Argsort: índice global de origen de cada posición de la salida.
+ *
+ * El índice de una llave es su posición en la concatenación de las entradas. Lo conoce el dueño del
+ * bloque tras el reduce, así que se ubica directo junto a su rank y las llaves no se mueven en la
+ * ubicación final (SortOptions::place_keys = false). El tipo del índice I debe alcanzar para n
+ * (int64_t si n > RANK32_MAX_N).
+ *
+ * @return Vista sobre los índices locales (todos en el proceso 0 con OutputMode::Gather).
+ */
+template <typename T, typename I, typename Compare = std::less<T>>
+KeySpan<I> rank_argsort(const Grid& grid, KeySpan<T> local_keys, SortWorkspace<T>& ws, ValueWorkspace<I>& vws,
+                        Compare comp = Compare(), SortOptions options = SortOptions()) {
+    options.place_keys = false;
+    rank_sort(grid, local_keys, ws, comp, options);
+
+    int size = grid.rows * grid.cols;
+    vws.values.resize(ws.row_counts[grid.col]);
+    std::iota(vws.values.begin(), vws.values.end(), static_cast<I>(block_start(grid.rank, ws.n, size)));
+    if (ws.wide_ranks) place_values(grid, ws.aggregated_ranks.wide, vws.values.data(), ws.n, options, vws);
+    else place_values(grid, ws.aggregated_ranks.narrow, vws.values.data(), ws.n, options, vws);
+    current_phase = PHASE_OTHER;
+    return KeySpan<I>(vws.output);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "local_rank.hpp"
+
+// Formatos comprimidos del gossip y el broadcast para llaves de rango chico (las del kernel de
+// conteo, llevadas a v = llave - lo en [0, span)):
+//  - empaquetado: cada llave ocupa bits_for_span(span) bits en palabras de 64 (con char alfanumérico,
+//    7 bits en vez de 8; con enteros de 64 bits y pocos valores, unos pocos bits en vez de 64);
+//  - histograma: de un bloque solo se manda cuántas veces aparece cada valor, span enteros sin
+//    importar el largo del bloque.
+// El ranking lee estos formatos directo (local_rank_packed), sin reconstruir las llaves.
+
+inline int bits_for_span(uint64_t span) {
+    int bits = 1;
+    while (bits < 64 && (uint64_t(1) << bits) < span) ++bits;
+    return bits;
+}
+
+inline size_t packed_words(size_t count, int bits) {
+    return (count * bits + 63) / 64;
+}
+
+// Empaqueta count llaves en words (packed_words(count, bits) palabras)
+template <typename T>
+void pack_keys(const T* keys, size_t count, uint64_t lo, int bits, uint64_t* words) {
+    // Se arma cada palabra en un registro y se escribe una vez llena
+    uint64_t word = 0;
+    int filled = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t v = static_cast<uint64_t>(keys[i]) - lo;
+        word |= v << filled;
+        filled += bits;
+        if (filled >= 64) {
+            *words++ = word;
+            filled -= 64;
+            word = filled ? v >> (bits - filled) : 0;
+        }
+    }
+    if (filled) *words = word;
+}
+
+// Valor (llave - lo) de la posición i
+inline uint64_t packed_value(const uint64_t* words, size_t i, int bits) {
+    size_t bit = i * bits;
+    int shift = bit % 64;
+    uint64_t v = words[bit / 64] >> shift;
+    if (shift + bits > 64) v |= words[bit / 64 + 1] << (64 - shift);
+    return bits == 64 ? v : v & ((uint64_t(1) << bits) - 1);
+}
+
+// Suma a hist (span enteros) las llaves de un bloque, crudo o empaquetado
+template <typename T>
+void add_histogram(const T* keys, size_t count, uint64_t lo, int* hist) {
+    for (size_t i = 0; i < count; ++i) hist[static_cast<uint64_t>(keys[i]) - lo]++;
+}
+
+inline void add_packed_histogram(const uint64_t* words, size_t count, int bits, int* hist) {
+    for (size_t i = 0; i < count; ++i) hist[packed_value(words, i, bits)]++;
+}
+
+/**
+ * @brief Kernel de conteo sobre la columna en histogramas y la fila empaquetada.
+ *
+ * La columna y la fila comparten un solo bloque, el propio (posición own_col en la fila). Como los
+ * bloques son tramos contiguos de índices, una llave de la fila con valor v de un bloque anterior al
+ * propio tiene rank before[v] (las menores de la columna más las iguales de los bloques de columna
+ * anteriores); de uno posterior, after[v] = before[v] + las iguales del bloque propio; y dentro del
+ * bloque propio se recorre en orden sumando las iguales ya vistas. Ningún bloque de la columna hace
+ * falta llave por llave.
+ *
+ * @param before, after Tablas de span enteros (ver compressed_local_ranks).
+ * @param row_words Bloques de la fila empaquetados, el bloque j desde word_displs[j].
+ */
+template <typename T>
+void local_rank_packed(ThreadPool* pool, const std::vector<int>& before, const std::vector<int>& after,
+                       const T* own_block, uint64_t lo, int own_col, const uint64_t* row_words,
+                       const std::vector<int>& word_displs, const std::vector<int>& row_counts,
+                       const std::vector<int>& row_displs, int bits, std::vector<int>& seen,
+                       std::vector<int>& rank_counts) {
+    rank_counts.resize(row_displs.back() + row_counts.back());
+    for (size_t j = 0; j < row_counts.size(); ++j) {
+        int* ranks = rank_counts.data() + row_displs[j];
+        if (static_cast<int>(j) == own_col) {
+            seen.assign(before.size(), 0);
+            for (int i = 0; i < row_counts[j]; ++i) {
+                uint64_t v = static_cast<uint64_t>(own_block[i]) - lo;
+                ranks[i] = before[v] + seen[v]++;
+            }
+            continue;
+        }
+        const std::vector<int>& table = static_cast<int>(j) < own_col ? before : after;
+        const uint64_t* words = row_words + word_displs[j];
+        parallel_for(pool, row_counts[j], [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) ranks[i] = table[packed_value(words, i, bits)];
+        }, PARALLEL_MIN_GRAIN);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+#include <climits>
+#include <algorithm>
+
+// Colectivas en las que el proceso root tiene las n llaves (scatter de la entrada, gather de la
+// salida y de los ranks). Cada proceso manda o recibe solo su bloque, que cabe en int, pero los
+// desplazamientos en el root llegan a n y dejan de caber en los int de MPI_Scatterv/MPI_Gatherv
+// cuando n pasa de INT_MAX. Mientras el total cabe se usa la llamada de siempre; si no, las
+// llamadas _c de MPI-4 (MPI_Count, MPI_Aint) o, con MPI < 4, mensajes punto a punto entre el root
+// y cada proceso en tramos de a lo más MAX_MESSAGE_COUNT elementos.
+// Los bloques van uno tras otro en orden de proceso: el bloque i empieza en counts[0] + ... + counts[i-1].
+
+const long long MAX_MESSAGE_COUNT = INT_MAX;
+const int LARGE_COUNT_TAG = 25;
+
+inline bool fits_int_count(long long total) {
+    return total <= MAX_MESSAGE_COUNT;
+}
+
+#if MPI_VERSION >= 4
+inline void large_layout(const std::vector<int>& counts, std::vector<MPI_Count>& large_counts,
+                         std::vector<MPI_Aint>& large_displs) {
+    large_counts.assign(counts.begin(), counts.end());
+    large_displs.assign(counts.size(), 0);
+    for (size_t i = 1; i < counts.size(); ++i) large_displs[i] = large_displs[i - 1] + counts[i - 1];
+}
+#else
+// Bloque propio (count elementos) <-> root, y en el root cada bloque <-> su proceso, en tramos.
+// to_root: gather; si no, scatter. Los tramos de un mismo par llegan en orden (mismo tag y comunicador).
+inline void chunked_root_exchange(bool to_root, char* block, int count, char* all, const std::vector<int>& counts,
+                                  MPI_Datatype type, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(type, &lb, &extent);
+
+    std::vector<MPI_Request> requests;
+    auto post = [&](bool receive, char* data, long long elements, int peer) {
+        for (long long done = 0; done < elements; done += MAX_MESSAGE_COUNT) {
+            int chunk = static_cast<int>(std::min(MAX_MESSAGE_COUNT, elements - done));
+            requests.emplace_back();
+            if (receive) MPI_Irecv(data + done * extent, chunk, type, peer, LARGE_COUNT_TAG, comm, &requests.back());
+            else MPI_Isend(data + done * extent, chunk, type, peer, LARGE_COUNT_TAG, comm, &requests.back());
+        }
+    };
+    if (rank == root) {
+        long long offset = 0;
+        for (int i = 0; i < size; ++i) {
+            post(to_root, all + offset * extent, counts[i], i);
+            offset += counts[i];
+        }
+    }
+    post(!to_root, block, count, root);
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+}
+#endif
+
+// MPI_Scatterv desde root de bloques consecutivos que suman total elementos. displs solo se usa
+// cuando total cabe en int.
+inline void scatterv_large(const void* send, const std::vector<int>& counts, const std::vector<int>& displs,
+                           MPI_Datatype type, void* recv, int recv_count, long long total, int root, MPI_Comm comm) {
+    if (fits_int_count(total)) {
+        MPI_Scatterv(send, counts.data(), displs.data(), type, recv, recv_count, type, root, comm);
+        return;
+    }
+#if MPI_VERSION >= 4
+    std::vector<MPI_Count> large_counts;
+    std::vector<MPI_Aint> large_displs;
+    large_layout(counts, large_counts, large_displs);
+    MPI_Scatterv_c(send, large_counts.data(), large_displs.data(), type, recv, recv_count, type, root, comm);
+#else
+    chunked_root_exchange(false, static_cast<char*>(recv), recv_count, const_cast<char*>(static_cast<const char*>(send)),
+                          counts, type, root, comm);
+#endif
+}
+
+// MPI_Gatherv a root, como scatterv_large
+inline void gatherv_large(const void* send, int send_count, MPI_Datatype type, void* recv, const std::vector<int>& counts,
+                          const std::vector<int>& displs, long long total, int root, MPI_Comm comm) {
+    if (fits_int_count(total)) {
+        MPI_Gatherv(send, send_count, type, recv, counts.data(), displs.data(), type, root, comm);
+        return;
+    }
+#if MPI_VERSION >= 4
+    std::vector<MPI_Count> large_counts;
+    std::vector<MPI_Aint> large_displs;
+    large_layout(counts, large_counts, large_displs);
+    MPI_Gatherv_c(send, send_count, type, recv, large_counts.data(), large_displs.data(), type, root, comm);
+#else
+    chunked_root_exchange(true, const_cast<char*>(static_cast<const char*>(send)), send_count, static_cast<char*>(recv),
+                          counts, type, root, comm);
+#endif
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+#include "thread_pool.hpp"
+
+// Kernels de ranking local: para cada llave de A, cuántas llaves de local_A la preceden.
+//  - Binary:   lower_bound por elemento sobre la columna ordenada, O(n log m).
+//  - Counting: histograma + suma prefija para llaves enteras de rango pequeño, O(n + m + sigma),
+//              y no necesita ordenar la columna.
+//  - Merge:    ordena A una vez (con su permutación) y la mezcla con la columna ordenada, O(n log n + m)
+//              pero con accesos secuenciales; conviene en bloques grandes.
+enum class RankKernel { Binary, Counting, Merge };
+
+// Rango máximo de llaves para el que el histograma compensa frente a lower_bound
+const uint64_t COUNTING_MIN_SPAN = 1 << 8;
+const uint64_t COUNTING_MAX_SPAN = 1 << 20;
+
+// Tamaño de bloque de fila a partir del cual se usa el kernel de mezcla (medido con bench_local_rank.cpp).
+// Si la columna es mucho más grande que la fila, el recorrido lineal de la columna domina y se queda lower_bound.
+const size_t MERGE_MIN_BLOCK = 1 << 10;
+const size_t MERGE_MAX_RATIO = 16;
+
+// Vista de solo lectura sobre llaves contiguas que no viven en un std::vector (por ejemplo, en una
+// ventana de memoria compartida). Los kernels que leen las llaves crudas aceptan cualquiera de los dos.
+template <typename T>
+struct KeySpan {
+    using value_type = T;
+
+    const T* ptr = nullptr;
+    size_t count = 0;
+
+    KeySpan() = default;
+    KeySpan(const T* ptr, size_t count) : ptr(ptr), count(count) {}
+    KeySpan(const std::vector<T>& v) : ptr(v.data()), count(v.size()) {}
+
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+};
+
+struct KernelChoice {
+    RankKernel kernel = RankKernel::Binary;
+    uint64_t lo = 0;   // menor llave (como entero sin signo)
+    uint64_t span = 0; // hi - lo + 1
+};
+
+// El kernel de conteo solo es válido para el orden natural de enteros
+template <typename T, typename Compare>
+constexpr bool counting_applicable() {
+    return std::is_integral<T>::value
+        && (std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value);
+}
+
+// Kernel para una columna ya ordenada, según el tamaño de la fila (o del tramo de fila) a rankear
+inline RankKernel sorted_rank_kernel(size_t local_size, size_t size) {
+    if (size >= MERGE_MIN_BLOCK && local_size <= MERGE_MAX_RATIO * size) return RankKernel::Merge;
+    return RankKernel::Binary;
+}
+
+// Elección a partir del rango de llaves [lo, hi] ya conocido (por ejemplo, reducido entre procesos)
+template <typename T, typename Compare>
+KernelChoice choose_rank_kernel(T lo, T hi, size_t local_size, size_t size, Compare) {
+    KernelChoice choice;
+    choice.kernel = sorted_rank_kernel(local_size, size);
+
+    if constexpr (counting_applicable<T, Compare>()) {
+        if (local_size == 0 || size == 0) return choice;
+
+        // Diferencia en aritmética sin signo: válida también para llaves con signo
+        uint64_t span = static_cast<uint64_t>(hi) - static_cast<uint64_t>(lo) + 1;
+        if (span != 0 && span <= COUNTING_MAX_SPAN && (span <= COUNTING_MIN_SPAN || span <= local_size + size)) {
+            choice.kernel = RankKernel::Counting;
+            choice.lo = static_cast<uint64_t>(lo);
+            choice.span = span;
+        }
+    }
+    return choice;
+}
+
+template <typename Keys, typename Compare>
+KernelChoice choose_rank_kernel(const Keys& local_A, const Keys& A, Compare comp) {
+    using T = typename Keys::value_type;
+    if (local_A.empty() || A.empty()) return choose_rank_kernel(T(), T(), local_A.size(), A.size(), comp);
+
+    auto [lo_a, hi_a] = std::minmax_element(local_A.begin(), local_A.end(), comp);
+    auto [lo_b, hi_b] = std::minmax_element(A.begin(), A.end(), comp);
+    T lo = std::min(*lo_a, *lo_b, comp);
+    T hi = std::max(*hi_a, *hi_b, comp);
+    return choose_rank_kernel(lo, hi, local_A.size(), A.size(), comp);
+}
+
+template <typename T, typename Compare>
+std::vector<int> local_rank(const std::vector<T>& local_A, const std::vector<T>& A, Compare comp) {
+    std::vector<int> rank_counts(A.size(), 0);
+
+    for (size_t i = 0; i < A.size(); i++) {
+        rank_counts[i] = std::lower_bound(local_A.begin(), local_A.end(), A[i], comp) - local_A.begin();
+        }
+
+    return rank_counts;
+}
+
+// lower_bound por elemento repartido entre los hilos del pool (cada elemento es independiente).
+// Escribe en rank_counts, que se reutiliza entre llamadas.
+template <typename T, typename Compare>
+void local_rank(ThreadPool* pool, const std::vector<T>& local_A, const std::vector<T>& A, Compare comp,
+                std::vector<int>& rank_counts) {
+    rank_counts.resize(A.size());
+
+    parallel_for(pool, A.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            rank_counts[i] = std::lower_bound(local_A.begin(), local_A.end(), A[i], comp) - local_A.begin();
+        }
+    }, PARALLEL_MIN_GRAIN);
+}
+
+template <typename T, typename Compare>
+std::vector<int> local_rank(ThreadPool* pool, const std::vector<T>& local_A, const std::vector<T>& A, Compare comp) {
+    std::vector<int> rank_counts;
+    local_rank(pool, local_A, A, comp, rank_counts);
+    return rank_counts;
+}
+
+// Llave junto a su índice de desempate: el índice global de origen o, en la malla, su posición en
+// la columna (ver tie_break_indices). Desempatar por índice hace que los ranks sean estables y
+// formen una permutación exacta, aun con llaves repetidas.
+template <typename T>
+using Indexed = std::pair<T, int>;
+
+template <typename Compare>
+struct IndexedCompare {
+    Compare comp;
+
+    template <typename T, typename I>
+    bool operator()(const std::pair<T, I>& a, const std::pair<T, I>& b) const {
+        if (comp(a.first, b.first)) return true;
+        if (comp(b.first, a.first)) return false;
+        return a.second < b.second;
+    }
+};
+
+template <typename Keys, typename T = typename Keys::value_type>
+void with_indices(const Keys& keys, const std::vector<int>& idx, std::vector<Indexed<T>>& indexed) {
+    indexed.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        indexed[i] = {keys[i], idx[i]};
+    }
+}
+
+template <typename Keys, typename T = typename Keys::value_type>
+std::vector<Indexed<T>> with_indices(const Keys& keys, const std::vector<int>& idx) {
+    std::vector<Indexed<T>> indexed;
+    with_indices(keys, idx, indexed);
+    return indexed;
+}
+
+// Memoria de trabajo de los kernels. Guardarla entre llamadas (ver SortWorkspace) evita volver a
+// asignar cuando los tamaños se repiten: resize/assign reutilizan la capacidad que ya tienen.
+struct CountingScratch {
+    std::vector<int> less_than;           // llaves de la columna menores que cada valor
+    std::vector<std::vector<int>> seen;   // seen inicial de cada tramo de A
+    std::vector<size_t> a_bounds, c_bounds;
+};
+
+template <typename K>
+struct RankScratch {
+    std::vector<std::pair<K, int>> merge_keys; // kernel de mezcla: llaves de A con su posición
+    CountingScratch counting;
+};
+
+// Versión estable del conteo: local_A y A deben venir en orden creciente de índice global
+// (así quedan tras el gossip y el broadcast). Se recorren a la par y seen[v] lleva cuántas
+// llaves iguales a lo + v de local_A tienen índice menor que el elemento actual de A.
+// El recorrido guarda su estado, así que A puede llegar por tramos consecutivos.
+template <typename T>
+class CountingRanker {
+public:
+    CountingRanker(KeySpan<T> local_A, const std::vector<int>& local_idx, uint64_t lo, uint64_t span)
+        : local_A(local_A), local_idx(local_idx), lo(lo), less_than(span + 1, 0), seen(span, 0) {
+        // less_than[v] = cantidad de llaves de local_A menores que lo + v
+        for (const T& x : local_A) {
+            less_than[static_cast<uint64_t>(x) - lo + 1]++;
+        }
+        std::partial_sum(less_than.begin(), less_than.end(), less_than.begin());
+    }
+
+    void rank(const T* A, const int* idx, size_t count, int* rank_counts) {
+        for (size_t i = 0; i < count; i++) {
+            while (j < local_A.size() && local_idx[j] < idx[i]) {
+                seen[static_cast<uint64_t>(local_A[j]) - lo]++;
+                j++;
+            }
+            uint64_t v = static_cast<uint64_t>(A[i]) - lo;
+            rank_counts[i] = less_than[v] + seen[v];
+        }
+    }
+
+private:
+    KeySpan<T> local_A;
+    const std::vector<int>& local_idx;
+    uint64_t lo;
+    std::vector<int> less_than;
+    std::vector<int> seen;
+    size_t j = 0;
+};
+
+// Conteo repartido por tramos: cada tramo de A hace su propio recorrido de local_A. Los histogramas
+// parciales de la columna (uno por tramo) dan el seen inicial de cada tramo, así que ningún hilo
+// recorre la columna desde el principio. Sin pool hay un solo tramo y es el recorrido de CountingRanker.
+template <typename Keys>
+void local_rank_counting(ThreadPool* pool, const Keys& local_A, const std::vector<int>& local_idx,
+                         const Keys& A, const std::vector<int>& idx, uint64_t lo, uint64_t span,
+                         std::vector<int>& rank_counts, CountingScratch& scratch) {
+    size_t parts = pool ? std::max<size_t>(1, std::min<size_t>(pool->size(), A.size() / PARALLEL_MIN_GRAIN)) : 1;
+
+    // Tramo k de A: [a_bounds[k], a_bounds[k+1]); su recorrido de local_A empieza en c_bounds[k]
+    std::vector<size_t>& a_bounds = scratch.a_bounds;
+    std::vector<size_t>& c_bounds = scratch.c_bounds;
+    a_bounds.resize(parts + 1);
+    c_bounds.resize(parts + 1);
+    for (size_t k = 0; k <= parts; ++k) {
+        a_bounds[k] = A.size() * k / parts;
+        c_bounds[k] = k == 0 ? 0 : k == parts ? local_A.size()
+            : std::lower_bound(local_idx.begin(), local_idx.end(), idx[a_bounds[k]]) - local_idx.begin();
+    }
+
+    // seen[k][v]: llaves lo + v de local_A en [c_bounds[k], c_bounds[k+1])
+    std::vector<std::vector<int>>& seen = scratch.seen;
+    seen.resize(parts);
+    parallel_for(pool, parts, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            seen[k].assign(span, 0);
+            for (size_t j = c_bounds[k]; j < c_bounds[k + 1]; ++j) seen[k][static_cast<uint64_t>(local_A[j]) - lo]++;
+        }
+    });
+
+    // Suma prefija entre tramos: seen[k][v] pasa a ser el valor con que arranca el tramo k,
+    // y el total por valor da el histograma completo para less_than
+    std::vector<int>& less_than = scratch.less_than;
+    less_than.assign(span + 1, 0);
+    parallel_for(pool, span, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            int running = 0;
+            for (size_t k = 0; k < parts; ++k) {
+                int c = seen[k][v];
+                seen[k][v] = running;
+                running += c;
+            }
+            less_than[v + 1] = running;
+        }
+    }, PARALLEL_MIN_GRAIN);
+    std::partial_sum(less_than.begin(), less_than.end(), less_than.begin());
+
+    rank_counts.resize(A.size());
+    parallel_for(pool, parts, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) {
+            std::vector<int>& part_seen = seen[k];
+            size_t j = c_bounds[k];
+            for (size_t i = a_bounds[k]; i < a_bounds[k + 1]; i++) {
+                while (j < local_A.size() && local_idx[j] < idx[i]) {
+                    part_seen[static_cast<uint64_t>(local_A[j]) - lo]++;
+                    j++;
+                }
+                uint64_t v = static_cast<uint64_t>(A[i]) - lo;
+                rank_counts[i] = less_than[v] + part_seen[v];
+            }
+        }
+    });
+}
+
+template <typename Keys>
+std::vector<int> local_rank_counting(ThreadPool* pool, const Keys& local_A, const std::vector<int>& local_idx,
+                                     const Keys& A, const std::vector<int>& idx, uint64_t lo, uint64_t span) {
+    std::vector<int> rank_counts;
+    CountingScratch scratch;
+    local_rank_counting(pool, local_A, local_idx, A, idx, lo, span, rank_counts, scratch);
+    return rank_counts;
+}
+
+template <typename Keys>
+std::vector<int> local_rank_counting(const Keys& local_A, const std::vector<int>& local_idx,
+                                     const Keys& A, const std::vector<int>& idx, uint64_t lo, uint64_t span) {
+    return local_rank_counting(nullptr, local_A, local_idx, A, idx, lo, span);
+}
+
+// Mezcla del tramo [begin, end) de A contra la columna ordenada; escribe los ranks en rank_counts.
+// sorted_A es memoria de trabajo para el tramo (end - begin pares).
+template <typename T, typename Compare>
+void local_rank_merge(const std::vector<T>& local_A, const std::vector<T>& A, size_t begin, size_t end,
+                      int* rank_counts, std::pair<T, int>* sorted_A, Compare comp) {
+    if (begin == end) return;
+
+    // Llave junto a su posición original para devolver los ranks en el orden de A
+    size_t count = end - begin;
+    for (size_t i = begin; i < end; i++) {
+        sorted_A[i - begin] = {A[i], static_cast<int>(i)};
+    }
+    std::sort(sorted_A, sorted_A + count,
+              [&](const std::pair<T, int>& a, const std::pair<T, int>& b) { return comp(a.first, b.first); });
+
+    // El recorrido de la columna empieza en la menor llave del tramo
+    size_t j = std::lower_bound(local_A.begin(), local_A.end(), sorted_A[0].first, comp) - local_A.begin();
+    for (size_t k = 0; k < count; k++) {
+        while (j < local_A.size() && comp(local_A[j], sorted_A[k].first)) j++;
+        rank_counts[sorted_A[k].second] = static_cast<int>(j);
+    }
+}
+
+// Cada tramo usa su parte de merge_keys, así que los tramos en paralelo no comparten memoria
+template <typename T, typename Compare>
+void local_rank_merge(ThreadPool* pool, const std::vector<T>& local_A, const std::vector<T>& A, Compare comp,
+                      std::vector<int>& rank_counts, std::vector<std::pair<T, int>>& merge_keys) {
+    rank_counts.resize(A.size());
+    merge_keys.resize(A.size());
+    parallel_for(pool, A.size(), [&](size_t begin, size_t end) {
+        local_rank_merge(local_A, A, begin, end, rank_counts.data(), merge_keys.data() + begin, comp);
+    }, PARALLEL_MIN_GRAIN);
+}
+
+template <typename T, typename Compare>
+std::vector<int> local_rank_merge(const std::vector<T>& local_A, const std::vector<T>& A, Compare comp) {
+    std::vector<int> rank_counts;
+    std::vector<std::pair<T, int>> merge_keys;
+    local_rank_merge(nullptr, local_A, A, comp, rank_counts, merge_keys);
+    return rank_counts;
+}
+
+// Kernels sobre una columna ya ordenada (Binary o Merge). Para ranks estables se usan con
+// Indexed<T> e IndexedCompare; el kernel de conteo va aparte porque no ordena la columna.
+template <typename T, typename Compare>
+void local_rank(ThreadPool* pool, const KernelChoice& choice, const std::vector<T>& local_A, const std::vector<T>& A,
+                Compare comp, std::vector<int>& rank_counts, RankScratch<T>& scratch) {
+    if (choice.kernel == RankKernel::Merge) local_rank_merge(pool, local_A, A, comp, rank_counts, scratch.merge_keys);
+    else local_rank(pool, local_A, A, comp, rank_counts);
+}
+
+template <typename T, typename Compare>
+std::vector<int> local_rank(ThreadPool* pool, const KernelChoice& choice, const std::vector<T>& local_A,
+                            const std::vector<T>& A, Compare comp) {
+    std::vector<int> rank_counts;
+    RankScratch<T> scratch;
+    local_rank(pool, choice, local_A, A, comp, rank_counts, scratch);
+    return rank_counts;
+}
+
+template <typename T, typename Compare>
+std::vector<int> local_rank(const KernelChoice& choice, const std::vector<T>& local_A, const std::vector<T>& A, Compare comp) {
+    return local_rank(nullptr, choice, local_A, A, comp);
+}
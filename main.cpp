@@ -1,309 +1,317 @@
-#include <map>
 #include <mpi.h>
 #include <string>
 #include <vector>
-#include <iterator>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <memory>
 #include <iostream>
 #include <algorithm>
-#include <random>
+#include <functional>
+#include <type_traits>
+#include <limits>
+#include <numeric>
 #include <iomanip> // Para std::setprecision
 using namespace std;
 
-float t1,t2,t3,t4,t5,t6,t7,t8;
-float t9, t10, t11, t12, t13, t14, t15, t16;
-float t_inicial, t_final;
+#include "sample_sort.hpp"
+#include "mpi_file_io.hpp"
+#include "external_sort.hpp"
+#include "workload.hpp"
+#include "cost_model.hpp"
 
-string generateRandomString(size_t length) {
-    const string_view characters = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    random_device rd;
-    mt19937 generator(rd());
-    uniform_int_distribution<size_t> distribution(0, characters.size() - 1);
+double t_inicial, t_final;
 
-    string randomString;
-    randomString.reserve(length);
+template <typename T>
+void run(int rank, int rows, int cols, long long n, SortOptions options, int threads, bool node_shared,
+         const string& payload, SortAlgorithm algorithm, long long crossover, Distribution dist, uint64_t seed) {
+    // Cada proceso genera su bloque (ver workload.hpp) y el proceso 0 junta la entrada antes de medir
+    vector<T> input = generate_input<T>(MPI_COMM_WORLD, dist, n, seed);
 
-    generate_n(back_inserter(randomString), length, [&]() {
-        return characters[distribution(generator)];
-    });
+    Grid grid = make_grid(rows, cols);
 
-    return randomString;
-}
-
-string concatenar(const map<int, string>& data_by_rank) {
-    string result;
-    for (const auto& entry : data_by_rank) {
-        result += entry.second;
+    // El pool y los comunicadores por nodo se crean fuera de la medición, igual que la malla
+    unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool = make_unique<ThreadPool>(threads);
+        options.pool = pool.get();
+    }
+    NodeGrid node;
+    if (node_shared) {
+        node = make_node_grid(grid);
+        options.node = &node;
     }
-    return result;
-}
-
-vector<int> local_rank(const string& local_A, const string& A) {
-    vector<int> rank_counts(A.size(), 0);
-
-    for (size_t i = 0; i < A.size(); i++) {
-        rank_counts[i] = lower_bound(local_A.begin(), local_A.end(), A[i]) - local_A.begin();
-        }
-
-    return rank_counts;
-}
-void gossip_step(int rank, int rows, int cols, int size, map<int, string>& local_data, int msg_size) {
-    int row = rank / cols;
-    int col = rank % cols;
-    char* recv_buffer = new char[msg_size * size + 1];
-
-    for (int step = 0; step < rows - 1; ++step) {
-        int send_to = ((row + 1) % rows) * cols + col;      // same col but below
-        int receive_from = ((row + rows - 1) % rows) * cols + col; // above same col
-
-        string send_buffer = concatenar(local_data);
-
-        MPI_Request send_request, recv_request;
-        MPI_Irecv(recv_buffer, msg_size * size + 1, MPI_CHAR, receive_from, 0, MPI_COMM_WORLD, &recv_request);
-        MPI_Isend(send_buffer.c_str(), send_buffer.size() + 1, MPI_CHAR, send_to, 0, MPI_COMM_WORLD, &send_request);
-
-        MPI_Wait(&recv_request, MPI_STATUS_IGNORE);
-        MPI_Wait(&send_request, MPI_STATUS_IGNORE);
-
-        string received_string(recv_buffer);
-        delete[] recv_buffer;
 
-        int source_rank = (rank - cols + size) % size; // calculate the rank of the data sender
-        local_data[source_rank] = received_string;
+    // Con payload cada llave lleva un int64 (llave-valor) o se pide su índice de origen (argsort);
+    // la entrada sigue entera en el proceso 0
+    SortWorkspace<T> ws;
+    ValueWorkspace<int64_t> values_ws;
+    ValueWorkspace<int> index_ws;
+    ValueWorkspace<int64_t> wide_index_ws; // argsort con más de RANK32_MAX_N llaves
+    vector<int64_t> values;
+    if (payload == "key-value") {
+        values.resize(input.size());
+        iota(values.begin(), values.end(), 0);
     }
-}
 
-void reverse_broadcast_step(int rank, int rows, int cols, const string& starting_data, map<int, string>& resulting_data, int msg_size, int size) {
-    int row = rank / cols;
-    int col = rank % cols;
-    char* recv_buffer = new char[msg_size * size + 1];
-
-    if (col == row) {
-        for (int c = 0; c < cols; ++c) {
-            if (c != col) {
-                int send_to = row * cols + c;
-                MPI_Send(starting_data.c_str(), starting_data.size() + 1, MPI_CHAR, send_to, 0, MPI_COMM_WORLD);
-            }
-        }
-        resulting_data[0] = starting_data;
+    t_inicial = MPI_Wtime();
+    if (payload == "key-value") {
+        KeySpan<int64_t> sorted_values;
+        rank_sort_by_key(grid, KeySpan<T>(input), KeySpan<int64_t>(values), ws, values_ws, sorted_values, less<T>(), options);
+    } else if (payload == "argsort") {
+        if (n > RANK32_MAX_N) rank_argsort(grid, KeySpan<T>(input), ws, wide_index_ws, less<T>(), options);
+        else rank_argsort(grid, KeySpan<T>(input), ws, index_ws, less<T>(), options);
     } else {
-        int send_from = row * cols + row;
-        MPI_Recv(recv_buffer, msg_size * size + 1, MPI_CHAR, send_from, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        string received_string(recv_buffer);
-        delete[] recv_buffer;
-        
-        resulting_data[0] = received_string;
+        vector<T> final_output = distributed_sort(grid, input, less<T>(), options, algorithm, crossover);
     }
-}
-string sort_and_print_by_rank(const vector<int>& aggregated_ranks, const string& result) {
-    vector<pair<int, char>> rank_with_indices;
+    t_final = MPI_Wtime();
 
-    for (size_t i = 0; i < result.size(); ++i) {
-        rank_with_indices.emplace_back(aggregated_ranks[i], result[i]);
-    }
+    if (node_shared) free_node_grid(node);
+    free_grid(grid);
 
-    sort(rank_with_indices.begin(), rank_with_indices.end());
-    string sorted_result;
+    if (rank == 0)
+    {
+        // El ordenamiento final en el proceso 0 no se cuenta; la distribución final sí es parte del algoritmo
+        double t_salida = options.output == OutputMode::Gather ? (t16 - t15) : 0;
 
-    for(const auto& rank : rank_with_indices) {
-        sorted_result += rank.second;
+        cout << fixed << setprecision(10);
+
+        cout << "Ejecucion: " << ((t_final - t_inicial) - t_salida) << endl;
+        cout << "Computo: " << ((t8 - t7) + (t10 - t9)) << endl;
+        cout << "Comunicacion: " << ((t_final - t_inicial) - t_salida - ((t8 - t7) + (t10 - t9))) << endl;
     }
-    return sorted_result;
 }
 
-string calculate_and_print_ranks(int rank, int rows, int cols, const string& starting_data, const string& result, int msg_size, int size) {
-    string sorted_starting_data = starting_data;
+// Entrada y salida en archivos binarios (MPI-IO): cada proceso lee su bloque, rank_sort ordena la
+// entrada ya repartida y, con --output, cada proceso escribe su tramo de la salida en su lugar.
+// El proceso 0 nunca tiene las n llaves.
+template <typename T>
+void run_files(int rank, int rows, int cols, SortOptions options, int threads, const string& input_path,
+               const string& output_path) {
+    Grid grid = make_grid(rows, cols);
+    int size = rows * cols;
+    unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool = make_unique<ThreadPool>(threads);
+        options.pool = pool.get();
+    }
+    if (!output_path.empty()) options.output = OutputMode::Distributed;
 
-    //SORT (4)
+    double t_lectura = MPI_Wtime();
+    vector<T> block;
+    long long n = 0;
+    read_block(grid.comm, input_path, block, n);
 
-    t7 = MPI_Wtime();
-    sort(sorted_starting_data.begin(), sorted_starting_data.end());
-    t8 = MPI_Wtime();
+    SortWorkspace<T> ws;
+    t_inicial = MPI_Wtime();
+    KeySpan<T> sorted = rank_sort(grid, KeySpan<T>(block), ws, less<T>(), options);
+    t_final = MPI_Wtime();
 
-    // LOCAL RANKING (5)
+    bool written = output_path.empty() || write_block(grid.comm, output_path, sorted, block_start(grid.rank, n, size));
+    double t_escritura = MPI_Wtime();
+    free_grid(grid);
 
-    t9 = MPI_Wtime();
-    vector<int> local_ranking = local_rank(sorted_starting_data, result);
-    t10 = MPI_Wtime();
+    if (rank == 0) {
+        double t_salida = options.output == OutputMode::Gather ? (t16 - t15) : 0;
 
-    string sorted_result;
+        cout << fixed << setprecision(10);
+
+        cout << "Lectura: " << (t_inicial - t_lectura) << endl;
+        cout << "Ejecucion: " << ((t_final - t_inicial) - t_salida) << endl;
+        cout << "Computo: " << ((t8 - t7) + (t10 - t9)) << endl;
+        cout << "Comunicacion: " << ((t_final - t_inicial) - t_salida - ((t8 - t7) + (t10 - t9))) << endl;
+        if (!output_path.empty()) cout << "Escritura: " << (t_escritura - t_final) << endl;
+        if (!written) cerr << "Error: Can't write '" << output_path << "'." << endl;
+    }
+}
 
-    MPI_Barrier(MPI_COMM_WORLD);
+// Fuera de memoria (--memory): corridas del tamaño del presupuesto ordenadas con rank_sort, volcadas
+// a spill_dir y mezcladas al final (ver external_sort.hpp)
+template <typename T>
+void run_external(int rank, int rows, int cols, ExternalSortOptions options, int threads, const string& input_path,
+                  const string& output_path) {
+    Grid grid = make_grid(rows, cols);
+    unique_ptr<ThreadPool> pool;
+    if (threads > 1) {
+        pool = make_unique<ThreadPool>(threads);
+        options.sort.pool = pool.get();
+    }
 
-    int row = rank / cols;
-    int col = rank % cols;
-    int diagonal_process = row * cols + row;
-    char* recv_buffer = new char[msg_size * size + 1];
-    string recv_word;
+    t_inicial = MPI_Wtime();
+    bool ok = external_rank_sort<T>(grid, input_path, output_path, less<T>(), options);
+    t_final = MPI_Wtime();
+    long long run_keys = run_keys_for_budget<T>(grid, options.memory_budget);
+    free_grid(grid);
 
-    // REDUCE (6)
-    // Enviar los datos a las diagonales
+    if (rank == 0) {
+        cout << fixed << setprecision(10);
 
-    t11 = MPI_Wtime();
-    if (col != row) 
-    {
-        MPI_Send(local_ranking.data(), local_ranking.size(), MPI_INT, diagonal_process, 0, MPI_COMM_WORLD);
-        // cout << "Process " << rank << " sent ranks to diagonal process " << diagonal_process << endl; (COMENTADO)
-    } 
-    else 
-    {
-        // Los ranks de la diagonal
-        vector<int> aggregated_ranks(local_ranking.size(), 0);
-        for (int c = 0; c < cols; ++c) 
-        {
-            // recibir desde la diagonal por cada uno y sumarlo al proceso principal
-            if (c != col) 
-            {
-                vector<int> received_ranks(local_ranking.size());
-                MPI_Recv(received_ranks.data(), received_ranks.size(), MPI_INT, row * cols + c, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                for (size_t i = 0; i < aggregated_ranks.size(); ++i) 
-                {
-                    aggregated_ranks[i] += received_ranks[i];
-                }
-            } 
-            else 
-            {   // si es el diagonal, se le suma igual
-                for (size_t i = 0; i < aggregated_ranks.size(); ++i) 
-                {
-                    aggregated_ranks[i] += local_ranking[i];
-                }
-            }
-        }
-        t12 = MPI_Wtime();
-
-        // GATHER (6)
-        // Después cada diagonal envía su ranking y string al proceso 0
-
-        t13 = MPI_Wtime();
-        if (rank != 0) 
-        {
-            MPI_Send(aggregated_ranks.data(), aggregated_ranks.size(), MPI_INT, 0, 1, MPI_COMM_WORLD);
-            MPI_Send(result.c_str(), result.size() + 1, MPI_CHAR, 0, 1, MPI_COMM_WORLD);
-            // cout << "Diagonal process " << rank << " sent aggregated ranks to Process 0" << endl; (COMENTADO)
-        } 
-        else 
-        {
-            vector<int> global_ranks(aggregated_ranks);
-
-            for (int r = 1; r < rows; ++r) 
-            {
-                int d_proc = r * cols + r; // proceso diagonal en base al iterador r
-                vector<int> received_ranks(aggregated_ranks.size());
-                // Recibe la info de cada diagonal
-                MPI_Recv(received_ranks.data(), received_ranks.size(), MPI_INT, d_proc, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Recv(recv_buffer, msg_size * size + 1, MPI_CHAR, d_proc, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                // Tranforma la información del buffer en una string
-                string received_string(recv_buffer);
-                
-                recv_word += received_string;
-
-                // cout << "Process 0 received ranks from diagonal process " << d_proc << endl; (COMENTADO)
-                // Expande global ranks
-                global_ranks.insert(global_ranks.end(), received_ranks.begin(), received_ranks.end());
-            }
-            delete[] recv_buffer;
-
-            t14 = MPI_Wtime();
-
-            t15 = MPI_Wtime();
-            sorted_result = sort_and_print_by_rank(global_ranks, (result + recv_word));
-            t16 = MPI_Wtime();
-        }
+        cout << "Llaves por corrida: " << run_keys << endl;
+        cout << "Corridas: " << t_runs << endl;
+        cout << "Mezcla: " << t_merge << endl;
+        cout << "Ejecucion: " << (t_final - t_inicial) << endl;
+        if (!ok) cerr << "Error: Can't write '" << output_path << "' or the runs in '" << options.spill_dir << "'." << endl;
     }
-    return sorted_result;
 }
 
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    // Modo híbrido: los hilos del pool nunca llaman a MPI, basta con FUNNELED
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    int sqrt_size = static_cast<int>(sqrt(size));
-    if (sqrt_size * sqrt_size != size) {
-        if (rank == 0) cerr << "Error: Number of processes must be a perfect square." << endl;
+    int rows, cols;
+    choose_grid_shape(size, rows, cols);
+
+    if (argc < 2) {
+        if (rank == 0) cerr << "Usage: mpiexec -n <num_processes> ./program <num_elements> [char|int64|double] [--distributed] [--pipelined[=chunks]] [--no-compress] [--grid=RxC] [--threads=N] [--node-shared] [--key-value|--argsort] [--autotune[=model]] [--algorithm=rank|sample|auto] [--input=file] [--output=file] [--memory=MB] [--spill=dir] [--dist=uniform|zipf|few-unique|sorted|reverse|organ-pipe] [--seed=S]" << endl;
         MPI_Finalize();
         return 1;
     }
 
-    const int rows = sqrt_size;
-    const int cols = sqrt_size;
+    // Cualquier n: los bloques se reparten con tamaños que difieren a lo más en uno
+    long long n = atoll(argv[1]);
+
+    string key_type = "char";
+    SortOptions options;
+    int threads = 1;
+    bool node_shared = false;
+    string payload;
+    bool autotuned = false;
+    SortAlgorithm algorithm = SortAlgorithm::Rank;
+    bool algorithm_set = false;
+    long long crossover = SAMPLE_SORT_MIN_N;
+    string model_path;
+    string input_path, output_path;
+    ExternalSortOptions external;
+    bool out_of_core = false;
+    Distribution dist = Distribution::Uniform;
+    string dist_name = "uniform";
+    uint64_t seed = DEFAULT_SEED;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--distributed") options.output = OutputMode::Distributed;
+        else if (arg == "--pipelined") options.pipelined = true;
+        else if (arg == "--no-compress") options.compress = false;
+        else if (arg.rfind("--pipelined=", 0) == 0) options.pipelined = true, options.chunks_per_block = max(1, atoi(arg.c_str() + 12));
+        else if (arg.rfind("--grid=", 0) == 0) sscanf(arg.c_str(), "--grid=%dx%d", &rows, &cols);
+        else if (arg.rfind("--threads=", 0) == 0) threads = max(1, atoi(arg.c_str() + 10));
+        else if (arg == "--node-shared") node_shared = true;
+        else if (arg == "--key-value" || arg == "--argsort") payload = arg.substr(2);
+        else if (arg == "--algorithm=sample") algorithm = SortAlgorithm::Sample, algorithm_set = true;
+        else if (arg == "--algorithm=auto") algorithm = SortAlgorithm::Auto, algorithm_set = true;
+        else if (arg == "--algorithm=rank") algorithm = SortAlgorithm::Rank, algorithm_set = true;
+        else if (arg == "--autotune") autotuned = true;
+        else if (arg.rfind("--autotune=", 0) == 0) autotuned = true, model_path = arg.substr(11);
+        else if (arg.rfind("--input=", 0) == 0) input_path = arg.substr(8);
+        else if (arg.rfind("--output=", 0) == 0) output_path = arg.substr(9);
+        else if (arg.rfind("--memory=", 0) == 0) out_of_core = true, external.memory_budget = size_t(atof(arg.c_str() + 9) * (1 << 20));
+        else if (arg.rfind("--spill=", 0) == 0) external.spill_dir = arg.substr(8);
+        else if (arg.rfind("--dist=", 0) == 0) dist_name = arg.substr(7);
+        else if (arg.rfind("--seed=", 0) == 0) seed = strtoull(arg.c_str() + 7, nullptr, 10);
+        else key_type = arg;
+    }
 
-    if (argc < 2) {
-        if (rank == 0) cerr << "Usage: mpiexec -n <num_processes> ./program <message_size>" << endl;
+    if (key_type != "char" && key_type != "int64" && key_type != "double") {
+        if (rank == 0) cerr << "Error: Unknown key type '" << key_type << "' (char, int64, double)." << endl;
         MPI_Finalize();
         return 1;
     }
 
-    int msg_size = atoi(argv[1])/size;
-    if (msg_size <= 0) {
-        if (rank == 0) cerr << "Error: Message size must be a positive integer." << endl;
+    if (!parse_distribution(dist_name, dist)) {
+        if (rank == 0) cerr << "Error: Unknown distribution '" << dist_name << "' (uniform, zipf, few-unique, sorted, reverse, organ-pipe)." << endl;
         MPI_Finalize();
         return 1;
     }
 
-    int total_elements = rows * cols;
-    string input;
-
-    if (rank == 0) {
-        input = generateRandomString(msg_size * total_elements);
-        if (input.size() % total_elements != 0) {
-            cerr << "Input Size [" << input.size() << "] doesn't match row * col size [" << total_elements << "]" << endl;
+    // Con --input, n es la cantidad de llaves del archivo y num_elements no se usa
+    int key_bytes = key_type == "char" ? sizeof(char) : sizeof(int64_t);
+    if (!input_path.empty()) {
+        n = file_elements(MPI_COMM_WORLD, input_path, key_bytes);
+        if (n < 0) {
+            if (rank == 0) cerr << "Error: Can't open '" << input_path << "'." << endl;
             MPI_Finalize();
             return 1;
         }
     }
+    if (n <= 0) {
+        if (rank == 0) cerr << "Error: Number of elements must be a positive integer." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    if (!output_path.empty() && input_path.empty()) {
+        if (rank == 0) cerr << "Error: --output needs --input." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    // La entrada por archivo solo ordena llaves con rank_sort (o el modo fuera de memoria)
+    if (!input_path.empty() && (!payload.empty() || node_shared || algorithm_set)) {
+        if (rank == 0) cerr << "Error: --input can't be combined with --key-value, --argsort, --node-shared or --algorithm." << endl;
+        MPI_Finalize();
+        return 1;
+    }
+    if (out_of_core && output_path.empty()) {
+        if (rank == 0) cerr << "Error: --memory needs --input and --output." << endl;
+        MPI_Finalize();
+        return 1;
+    }
 
-    char* local_string = new char[msg_size + 1];
-    local_string[msg_size] = '\0';
-
-    //SCATTER (1)
-
-    t_inicial = MPI_Wtime();
-
-    t1 = MPI_Wtime();
-    MPI_Scatter(input.c_str(), msg_size, MPI_CHAR, local_string, msg_size, MPI_CHAR, 0, MPI_COMM_WORLD);
-    t2 = MPI_Wtime();
-
-    string local_data_str(local_string);
-    delete[] local_string;
-
-    // cout << "Process " << rank << " received: " << local_data_str << endl;  (COMENTADO)
-
-    map<int, string> local_data = {{rank, local_data_str}};
-    map<int, string> resulting_data;
-
-    // GOSSIP (2)
-
-    t3 = MPI_Wtime();
-    gossip_step(rank, rows, cols, size, local_data, msg_size/size);
-    t4 = MPI_Wtime();
-    string gossip_result = concatenar(local_data);
-
-    // BROADCAST (3)
-
-    t5 = MPI_Wtime();
-    reverse_broadcast_step(rank, rows, cols, gossip_result, resulting_data, msg_size, size);
-    t6 = MPI_Wtime();
-
-    string result2 = concatenar(resulting_data);
-
-    // SORT, LOCAL, RANKING, REDUCE Y GATHER
-    string final_output = calculate_and_print_ranks(rank, rows, cols, gossip_result, result2, msg_size, size);
+    if (node_shared && options.pipelined) {
+        if (rank == 0) cerr << "Error: --node-shared can't be combined with --pipelined." << endl;
+        MPI_Finalize();
+        return 1;
+    }
 
-    t_final = MPI_Wtime();
+    if (threads > 1 && provided < MPI_THREAD_FUNNELED) {
+        if (rank == 0) cerr << "Warning: MPI doesn't provide MPI_THREAD_FUNNELED, running with 1 thread per process." << endl;
+        threads = 1;
+    }
 
-    // if (rank == 0) cout << "Final result: " << final_output << endl;
+    // Autotune: malla, kernel y solapamiento según el modelo de costo (ver cost_model.hpp). Las
+    // constantes salen del archivo de ./calibrate o, si no está, de una calibración corta aquí.
+    if (autotuned) {
+        CostModel model;
+        if (model_path.empty() || !load_cost_model(model_path, model)) model = calibrate(MPI_COMM_WORLD);
+        Tuning config = autotune(model, n, size, key_bytes, threads, options.output);
+        rows = config.rows;
+        cols = config.cols;
+        apply_tuning(config, options);
+        crossover = sample_sort_crossover(model, size, key_bytes, threads, options.output);
+        if (rank == 0) cout << "Autotune: " << rows << "x" << cols << " " << kernel_name(config.kernel)
+                            << (config.pipelined ? " pipelined" : "") << " (predicho " << config.predicted
+                            << "), sample sort desde n = " << crossover << endl;
+        if (node_shared && options.pipelined) {
+            if (rank == 0) cerr << "Warning: --node-shared doesn't combine with pipelined, running without it." << endl;
+            options.pipelined = false;
+        }
+    }
 
-    if (rank == 0)
-    {
-        cout << fixed << setprecision(10);
+    if (rows <= 0 || cols <= 0 || rows * cols != size) {
+        if (rank == 0) cerr << "Error: Grid " << rows << "x" << cols << " doesn't match " << size << " processes." << endl;
+        MPI_Finalize();
+        return 1;
+    }
 
-        cout << "Ejecucion: " << ((t_final - t_inicial) - (t16 - t15)) << endl;
-        cout << "Computo: " << ((t8 - t7) + (t10 - t9)) << endl;
-        cout << "Comunicacion: " << ((t_final - t_inicial) - (t16 - t15) - ((t8 - t7) + (t10 - t9))) << endl;
+    if (out_of_core) {
+        external.sort = options;
+        if (key_type == "char") run_external<char>(rank, rows, cols, external, threads, input_path, output_path);
+        else if (key_type == "int64") run_external<int64_t>(rank, rows, cols, external, threads, input_path, output_path);
+        else if (key_type == "double") run_external<double>(rank, rows, cols, external, threads, input_path, output_path);
+    } else if (!input_path.empty()) {
+        if (key_type == "char") run_files<char>(rank, rows, cols, options, threads, input_path, output_path);
+        else if (key_type == "int64") run_files<int64_t>(rank, rows, cols, options, threads, input_path, output_path);
+        else if (key_type == "double") run_files<double>(rank, rows, cols, options, threads, input_path, output_path);
+    } else if (key_type == "char") {
+        run<char>(rank, rows, cols, n, options, threads, node_shared, payload, algorithm, crossover, dist, seed);
+    } else if (key_type == "int64") {
+        run<int64_t>(rank, rows, cols, n, options, threads, node_shared, payload, algorithm, crossover, dist, seed);
+    } else if (key_type == "double") {
+        run<double>(rank, rows, cols, n, options, threads, node_shared, payload, algorithm, crossover, dist, seed);
     }
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
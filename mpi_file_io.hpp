@@ -0,0 +1,59 @@
+#pragma once
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+
+#include "grid_rank_sort.hpp"
+
+// Entrada y salida en archivos binarios con MPI-IO: cada proceso lee y escribe solo su bloque, con
+// llamadas colectivas (_at_all) que la implementación puede agregar entre procesos. Ningún proceso
+// pasa por todas las llaves, así que el ancho de banda de E/S crece con p.
+// Formato: el arreglo de llaves tal cual en memoria (sizeof(T) bytes cada una, sin encabezado).
+
+// Cantidad de llaves de element_bytes bytes en el archivo (colectiva); -1 si no se puede abrir
+inline long long file_elements(MPI_Comm comm, const std::string& path, int element_bytes) {
+    MPI_File file;
+    if (MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) return -1;
+    MPI_Offset bytes;
+    MPI_File_get_size(file, &bytes);
+    MPI_File_close(&file);
+    return bytes / element_bytes;
+}
+
+// Lee el bloque [rank*n/p, (rank+1)*n/p) del archivo; n sale del tamaño del archivo. Devuelve
+// false (en todos los procesos) si el archivo no se puede abrir.
+template <typename T>
+bool read_block(MPI_Comm comm, const std::string& path, std::vector<T>& block, long long& n) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+
+    MPI_File file;
+    if (MPI_File_open(comm, path.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS) return false;
+    MPI_Offset bytes;
+    MPI_File_get_size(file, &bytes);
+    n = bytes / static_cast<MPI_Offset>(sizeof(T));
+
+    long long first = block_start(rank, n, size);
+    block.resize(block_size(rank, n, size));
+    MPI_File_read_at_all(file, first * sizeof(T), block.data(), static_cast<int>(block.size()), mpi_type<T>::get(),
+                         MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+    return true;
+}
+
+// Escribe las llaves ordenadas locales desde la posición global offset: con OutputMode::Distributed,
+// offset = block_start(rank, n, p), el primer rank global que le toca al proceso
+template <typename T>
+bool write_block(MPI_Comm comm, const std::string& path, KeySpan<T> sorted, long long offset) {
+    MPI_File file;
+    if (MPI_File_open(comm, path.c_str(), MPI_MODE_WRONLY | MPI_MODE_CREATE, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        return false;
+    // Un archivo previo más largo no debe dejar llaves viejas al final
+    MPI_File_set_size(file, 0);
+    MPI_File_write_at_all(file, offset * sizeof(T), sorted.data(), static_cast<int>(sorted.size()), mpi_type<T>::get(),
+                          MPI_STATUS_IGNORE);
+    MPI_File_close(&file);
+    return true;
+}
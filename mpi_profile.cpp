@@ -0,0 +1,405 @@
+#include <mpi.h>
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <unordered_map>
+#include "grid_rank_sort.hpp"
+
+// Capa de perfilado PMPI: intercepta las llamadas MPI de grid_rank_sort.hpp y lleva, por fase
+// (current_phase) y por proceso, bytes enviados y recibidos, mensajes y tiempo de espera dentro de
+// MPI. Al final de la corrida (MPI_Finalize) el proceso 0 imprime el resumen de todos los procesos.
+// Se activa enlazándola junto al programa, sin tocar el código:
+//     mpicxx -O2 -std=c++17 main.cpp mpi_profile.cpp -o program
+//
+// Los bytes son el volumen lógico de cada colectiva: lo que el proceso aporta a los demás y lo que
+// recibe de ellos (sin contarse a sí mismo), no lo que mueve por dentro el algoritmo de la
+// implementación; así se comparan directo con los términos n/sqrt(p) de los modelos de costo.
+// Mensajes: pares (origen, destino) distintos con datos. Espera: tiempo dentro de las colectivas
+// bloqueantes y de MPI_Wait/MPI_Waitall; la espera de una colectiva no bloqueante se atribuye a
+// la fase que la inició.
+// La E/S de archivo (MPI_File_read_at/write_at y sus versiones _all) se cuenta aparte, en MB leídos
+// y escritos por fase, porque no es comunicación entre procesos; su tiempo cuenta como espera.
+
+namespace {
+
+struct PhaseCounters {
+    double bytes_sent = 0, bytes_recv = 0, messages = 0, wait = 0, calls = 0, file_read = 0, file_written = 0;
+};
+
+PhaseCounters counters[NUM_PHASES + 1];
+std::unordered_map<MPI_Request, int> request_phase;
+
+struct CommInfo {
+    int rank, size;
+};
+
+CommInfo comm_info(MPI_Comm comm) {
+    CommInfo info;
+    PMPI_Comm_rank(comm, &info.rank);
+    PMPI_Comm_size(comm, &info.size);
+    return info;
+}
+
+double type_bytes(MPI_Datatype type) {
+    int size;
+    PMPI_Type_size(type, &size);
+    return size;
+}
+
+// Volumen de un reparto con cantidades por proceso (vistas desde un lado); int o MPI_Count
+template <typename Count>
+void count_to_peers(const Count* counts, double unit, int self, int size, double& bytes, double& messages) {
+    for (int i = 0; i < size; ++i) {
+        if (i == self || counts[i] == 0) continue;
+        bytes += counts[i] * unit;
+        messages++;
+    }
+}
+
+// Registra una llamada de la fase en curso que empezó en start
+PhaseCounters& record(double start) {
+    PhaseCounters& c = counters[current_phase];
+    c.wait += PMPI_Wtime() - start;
+    c.calls++;
+    return c;
+}
+
+void track(MPI_Request request) {
+    request_phase[request] = current_phase;
+}
+
+// Espera de una colectiva no bloqueante: va a la fase que la inició
+void record_wait(MPI_Request request, double seconds) {
+    auto it = request_phase.find(request);
+    int phase = it == request_phase.end() ? current_phase : it->second;
+    if (it != request_phase.end()) request_phase.erase(it);
+    counters[phase].wait += seconds;
+}
+
+void allgatherv_volume(PhaseCounters& c, const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                       const int* recvcounts, MPI_Datatype recvtype, MPI_Comm comm) {
+    CommInfo info = comm_info(comm);
+    double own = sendbuf == MPI_IN_PLACE ? recvcounts[info.rank] * type_bytes(recvtype) : sendcount * type_bytes(sendtype);
+    if (own > 0) {
+        c.bytes_sent += own * (info.size - 1);
+        c.messages += info.size - 1;
+    }
+    double ignored = 0;
+    count_to_peers(recvcounts, type_bytes(recvtype), info.rank, info.size, c.bytes_recv, ignored);
+}
+
+void bcast_volume(PhaseCounters& c, int count, MPI_Datatype type, int root, MPI_Comm comm) {
+    CommInfo info = comm_info(comm);
+    double bytes = count * type_bytes(type);
+    if (info.rank == root) {
+        if (bytes > 0) {
+            c.bytes_sent += bytes * (info.size - 1);
+            c.messages += info.size - 1;
+        }
+    } else {
+        c.bytes_recv += bytes;
+    }
+}
+
+} // namespace
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                  MPI_Datatype recvtype, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    double bytes = recvcount * type_bytes(recvtype) * (info.size - 1);
+    c.bytes_sent += bytes;
+    c.bytes_recv += bytes;
+    c.messages += info.size - 1;
+    return err;
+}
+
+int MPI_Allgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                   const int displs[], MPI_Datatype recvtype, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Allgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm);
+    allgatherv_volume(record(start), sendbuf, sendcount, sendtype, recvcounts, recvtype, comm);
+    return err;
+}
+
+int MPI_Iallgatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                    const int displs[], MPI_Datatype recvtype, MPI_Comm comm, MPI_Request* request) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Iallgatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, comm, request);
+    allgatherv_volume(record(start), sendbuf, sendcount, sendtype, recvcounts, recvtype, comm);
+    track(*request);
+    return err;
+}
+
+int MPI_Bcast(void* buffer, int count, MPI_Datatype type, int root, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Bcast(buffer, count, type, root, comm);
+    bcast_volume(record(start), count, type, root, comm);
+    return err;
+}
+
+int MPI_Ibcast(void* buffer, int count, MPI_Datatype type, int root, MPI_Comm comm, MPI_Request* request) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Ibcast(buffer, count, type, root, comm, request);
+    bcast_volume(record(start), count, type, root, comm);
+    track(*request);
+    return err;
+}
+
+int MPI_Scatterv(const void* sendbuf, const int sendcounts[], const int displs[], MPI_Datatype sendtype, void* recvbuf,
+                 int recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Scatterv(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    if (info.rank == root) count_to_peers(sendcounts, type_bytes(sendtype), root, info.size, c.bytes_sent, c.messages);
+    else c.bytes_recv += recvcount * type_bytes(recvtype);
+    return err;
+}
+
+int MPI_Gatherv(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, const int recvcounts[],
+                const int displs[], MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Gatherv(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    if (info.rank == root) {
+        double ignored = 0;
+        count_to_peers(recvcounts, type_bytes(recvtype), root, info.size, c.bytes_recv, ignored);
+    } else if (sendcount > 0) {
+        c.bytes_sent += sendcount * type_bytes(sendtype);
+        c.messages++;
+    }
+    return err;
+}
+
+// Cantidades de ranks y valores en la ubicación con salida reunida
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+               MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    if (info.rank == root) {
+        c.bytes_recv += recvcount * type_bytes(recvtype) * (info.size - 1);
+    } else if (sendcount > 0) {
+        c.bytes_sent += sendcount * type_bytes(sendtype);
+        c.messages++;
+    }
+    return err;
+}
+
+#if MPI_VERSION >= 4
+// Scatterv y Gatherv con cantidades grandes (large_count.hpp)
+int MPI_Scatterv_c(const void* sendbuf, const MPI_Count sendcounts[], const MPI_Aint displs[], MPI_Datatype sendtype,
+                   void* recvbuf, MPI_Count recvcount, MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Scatterv_c(sendbuf, sendcounts, displs, sendtype, recvbuf, recvcount, recvtype, root, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    if (info.rank == root) count_to_peers(sendcounts, type_bytes(sendtype), root, info.size, c.bytes_sent, c.messages);
+    else c.bytes_recv += recvcount * type_bytes(recvtype);
+    return err;
+}
+
+int MPI_Gatherv_c(const void* sendbuf, MPI_Count sendcount, MPI_Datatype sendtype, void* recvbuf,
+                  const MPI_Count recvcounts[], const MPI_Aint displs[], MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Gatherv_c(sendbuf, sendcount, sendtype, recvbuf, recvcounts, displs, recvtype, root, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    if (info.rank == root) {
+        double ignored = 0;
+        count_to_peers(recvcounts, type_bytes(recvtype), root, info.size, c.bytes_recv, ignored);
+    } else if (sendcount > 0) {
+        c.bytes_sent += sendcount * type_bytes(sendtype);
+        c.messages++;
+    }
+    return err;
+}
+#endif
+
+// Punto a punto no bloqueante (los tramos de large_count.hpp con MPI < 4): el volumen va a la fase
+// que lo inicia y la espera se atribuye como en las colectivas no bloqueantes
+int MPI_Isend(const void* buf, int count, MPI_Datatype type, int dest, int tag, MPI_Comm comm, MPI_Request* request) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Isend(buf, count, type, dest, tag, comm, request);
+    PhaseCounters& c = record(start);
+    if (dest != comm_info(comm).rank && count > 0) {
+        c.bytes_sent += count * type_bytes(type);
+        c.messages++;
+    }
+    track(*request);
+    return err;
+}
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype type, int source, int tag, MPI_Comm comm, MPI_Request* request) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Irecv(buf, count, type, source, tag, comm, request);
+    PhaseCounters& c = record(start);
+    if (source != comm_info(comm).rank) c.bytes_recv += count * type_bytes(type);
+    track(*request);
+    return err;
+}
+
+int MPI_Alltoall(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Alltoall(sendbuf, sendcount, sendtype, recvbuf, recvcount, recvtype, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    c.bytes_sent += sendcount * type_bytes(sendtype) * (info.size - 1);
+    c.bytes_recv += recvcount * type_bytes(recvtype) * (info.size - 1);
+    c.messages += info.size - 1;
+    return err;
+}
+
+int MPI_Alltoallv(const void* sendbuf, const int sendcounts[], const int sdispls[], MPI_Datatype sendtype,
+                  void* recvbuf, const int recvcounts[], const int rdispls[], MPI_Datatype recvtype, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Alltoallv(sendbuf, sendcounts, sdispls, sendtype, recvbuf, recvcounts, rdispls, recvtype, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    double ignored = 0;
+    count_to_peers(sendcounts, type_bytes(sendtype), info.rank, info.size, c.bytes_sent, c.messages);
+    count_to_peers(recvcounts, type_bytes(recvtype), info.rank, info.size, c.bytes_recv, ignored);
+    return err;
+}
+
+// Cada proceso aporta sus sumas parciales de los tramos ajenos y recibe las de su tramo
+int MPI_Reduce_scatter(const void* sendbuf, void* recvbuf, const int recvcounts[], MPI_Datatype type, MPI_Op op,
+                       MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Reduce_scatter(sendbuf, recvbuf, recvcounts, type, op, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    count_to_peers(recvcounts, type_bytes(type), info.rank, info.size, c.bytes_sent, c.messages);
+    c.bytes_recv += recvcounts[info.rank] * type_bytes(type) * (info.size - 1);
+    return err;
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Allreduce(sendbuf, recvbuf, count, type, op, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    double bytes = count * type_bytes(type) * (info.size - 1);
+    c.bytes_sent += bytes;
+    c.bytes_recv += bytes;
+    c.messages += info.size - 1;
+    return err;
+}
+
+// Prefijo exclusivo: cada proceso aporta su valor a los de rango mayor y recibe el de los menores
+int MPI_Exscan(const void* sendbuf, void* recvbuf, int count, MPI_Datatype type, MPI_Op op, MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Exscan(sendbuf, recvbuf, count, type, op, comm);
+    PhaseCounters& c = record(start);
+    CommInfo info = comm_info(comm);
+    double bytes = count * type_bytes(type);
+    c.bytes_sent += bytes * (info.size - 1 - info.rank);
+    c.bytes_recv += bytes * info.rank;
+    c.messages += info.size - 1 - info.rank;
+    return err;
+}
+
+int MPI_File_read_at(MPI_File fh, MPI_Offset offset, void* buf, int count, MPI_Datatype type, MPI_Status* status) {
+    double start = PMPI_Wtime();
+    int err = PMPI_File_read_at(fh, offset, buf, count, type, status);
+    record(start).file_read += count * type_bytes(type);
+    return err;
+}
+
+int MPI_File_read_at_all(MPI_File fh, MPI_Offset offset, void* buf, int count, MPI_Datatype type, MPI_Status* status) {
+    double start = PMPI_Wtime();
+    int err = PMPI_File_read_at_all(fh, offset, buf, count, type, status);
+    record(start).file_read += count * type_bytes(type);
+    return err;
+}
+
+int MPI_File_write_at(MPI_File fh, MPI_Offset offset, const void* buf, int count, MPI_Datatype type,
+                      MPI_Status* status) {
+    double start = PMPI_Wtime();
+    int err = PMPI_File_write_at(fh, offset, buf, count, type, status);
+    record(start).file_written += count * type_bytes(type);
+    return err;
+}
+
+int MPI_File_write_at_all(MPI_File fh, MPI_Offset offset, const void* buf, int count, MPI_Datatype type,
+                          MPI_Status* status) {
+    double start = PMPI_Wtime();
+    int err = PMPI_File_write_at_all(fh, offset, buf, count, type, status);
+    record(start).file_written += count * type_bytes(type);
+    return err;
+}
+
+int MPI_Barrier(MPI_Comm comm) {
+    double start = PMPI_Wtime();
+    int err = PMPI_Barrier(comm);
+    record(start);
+    return err;
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+    MPI_Request waited = *request;
+    double start = PMPI_Wtime();
+    int err = PMPI_Wait(request, status);
+    record_wait(waited, PMPI_Wtime() - start);
+    return err;
+}
+
+// El tiempo de un Waitall se reparte en partes iguales entre sus requests
+int MPI_Waitall(int count, MPI_Request requests[], MPI_Status statuses[]) {
+    std::vector<MPI_Request> waited(requests, requests + count);
+    double start = PMPI_Wtime();
+    int err = PMPI_Waitall(count, requests, statuses);
+    double seconds = PMPI_Wtime() - start;
+    for (MPI_Request request : waited) record_wait(request, count > 0 ? seconds / count : 0);
+    return err;
+}
+
+// Resumen: llamadas por proceso, total de mensajes y bytes, máximo por proceso y espera promedio y máxima
+int MPI_Finalize() {
+    const int FIELDS = 7;
+    double local[(NUM_PHASES + 1) * FIELDS], total[(NUM_PHASES + 1) * FIELDS], maximum[(NUM_PHASES + 1) * FIELDS];
+    for (int j = 0; j <= NUM_PHASES; ++j) {
+        const PhaseCounters& c = counters[j];
+        double values[FIELDS] = {c.calls, c.messages, c.bytes_sent, c.bytes_recv, c.wait, c.file_read, c.file_written};
+        std::copy(values, values + FIELDS, local + j * FIELDS);
+    }
+    int rank, size;
+    PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    PMPI_Comm_size(MPI_COMM_WORLD, &size);
+    PMPI_Reduce(local, total, (NUM_PHASES + 1) * FIELDS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    PMPI_Reduce(local, maximum, (NUM_PHASES + 1) * FIELDS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        std::printf("\nComunicacion por fase (%d procesos; bytes en MB, espera en segundos)\n", size);
+        std::printf("%-10s %8s %10s %12s %12s %12s %12s %12s\n", "fase", "llamadas", "mensajes", "MB enviados",
+                    "env max/proc", "rec max/proc", "espera prom", "espera max");
+        for (int j = 0; j <= NUM_PHASES; ++j) {
+            const double* t = total + j * FIELDS;
+            const double* m = maximum + j * FIELDS;
+            if (t[0] == 0) continue;
+            std::printf("%-10s %8.0f %10.0f %12.4f %12.4f %12.4f %12.6f %12.6f\n", PHASE_NAMES[j], m[0], t[1],
+                        t[2] / 1e6, m[2] / 1e6, m[3] / 1e6, t[4] / size, m[4]);
+        }
+        bool file_io = false;
+        for (int j = 0; j <= NUM_PHASES; ++j) file_io |= total[j * FIELDS + 5] + total[j * FIELDS + 6] > 0;
+        if (file_io) {
+            std::printf("\nE/S de archivo por fase (MB)\n");
+            std::printf("%-10s %12s %12s %12s %12s\n", "fase", "leidos", "escritos", "lee max/proc", "esc max/proc");
+            for (int j = 0; j <= NUM_PHASES; ++j) {
+                const double* t = total + j * FIELDS;
+                const double* m = maximum + j * FIELDS;
+                if (t[5] + t[6] == 0) continue;
+                std::printf("%-10s %12.4f %12.4f %12.4f %12.4f\n", PHASE_NAMES[j], t[5] / 1e6, t[6] / 1e6, m[5] / 1e6,
+                            m[6] / 1e6);
+            }
+        }
+        std::fflush(stdout);
+    }
+    return PMPI_Finalize();
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+
+#include "grid_rank_sort.hpp"
+
+// Sample sort paralelo (muestreo regular, PSRS) con la misma interfaz que grid_rank_sort, para
+// comparar con el ordenamiento por ranking y pasar a él cuando n es grande: cada proceso mueve
+// O(n/p) llaves en vez de las O(n/sqrt(p)) del gossip y el broadcast.
+//  1. Scatter del bloque propio y sort local de pares (llave, índice global).
+//  2. p - 1 muestras regulares por proceso, Allgather, y p - 1 splitters.
+//  3. Alltoallv de las llaves por cubeta y mezcla de los p tramos recibidos.
+//  4. Salida: Gatherv al proceso 0 o rebalanceo a los bloques [i*n/p, (i+1)*n/p).
+// Los splitters son pares (llave, índice), así que las llaves repetidas se reparten entre cubetas
+// igual que las distintas, y el resultado es estable como el de grid_rank_sort. Los tiempos van en
+// los mismos contadores: GOSSIP es el muestreo y BROADCAST el Alltoallv; RANK y REDUCE no se usan.
+// El índice global va en int hasta RANK32_MAX_N llaves y en int64_t desde ahí.
+
+enum class SortAlgorithm { Rank, Sample, Auto };
+
+// Desde este n conviene sample sort (SortAlgorithm::Auto). Cruce medido con ./benchmark --algorithm=both
+// en una sola máquina con 4 y 9 procesos (entre 10^2 y 10^4 llaves); en un cluster conviene medirlo
+// de nuevo o predecirlo con sample_sort_crossover (cost_model.hpp), como hace main.cpp --autotune.
+const long long SAMPLE_SORT_MIN_N = 1LL << 12;
+
+// Sample sort con índices globales de tipo I
+template <typename I, typename T, typename Compare>
+std::vector<T> indexed_sample_sort(const Grid& grid, const std::vector<T>& input, long long n, Compare comp,
+                                   const SortOptions& options) {
+    using Entry = std::pair<T, I>;
+    int size = grid.rows * grid.cols;
+
+    SortWorkspace<T> ws;
+    std::vector<int> all_blocks(size);
+    std::iota(all_blocks.begin(), all_blocks.end(), 0);
+    block_counts(all_blocks, n, size, ws.counts, ws.displs);
+    int local_count = ws.counts[grid.rank];
+    I first = static_cast<I>(block_start(grid.rank, n, size));
+
+    //SCATTER (1)
+
+    t1 = begin_phase(PHASE_SCATTER);
+    std::vector<T> local_block(local_count);
+    scatterv_large(input.data(), ws.counts, ws.displs, mpi_type<T>::get(), local_block.data(), local_count, n, 0,
+                   grid.comm);
+    t2 = MPI_Wtime();
+
+    //SORT (4), local
+
+    t7 = begin_phase(PHASE_SORT);
+    IndexedCompare<Compare> indexed_comp{comp};
+    std::vector<Entry> sorted(local_count);
+    for (int i = 0; i < local_count; ++i) sorted[i] = {local_block[i], first + i};
+    parallel_sort(options.pool, sorted, indexed_comp);
+    double sort_time = MPI_Wtime() - t7;
+
+    // MUESTREO (2): p - 1 muestras regulares por proceso y p - 1 splitters sobre las p(p - 1)
+
+    t3 = begin_phase(PHASE_GOSSIP);
+    int samples = size - 1;
+    std::vector<T> sample_keys(samples);
+    std::vector<I> sample_idx(samples);
+    for (int k = 0; k < samples; ++k) {
+        // Con bloques vacíos la muestra es la mayor llave posible: (llave cualquiera, índice n)
+        if (local_count == 0) {
+            sample_keys[k] = T();
+            sample_idx[k] = static_cast<I>(n);
+            continue;
+        }
+        const Entry& s = sorted[static_cast<long long>(local_count) * (k + 1) / size];
+        sample_keys[k] = s.first;
+        sample_idx[k] = s.second;
+    }
+    std::vector<T> all_keys(size * samples);
+    std::vector<I> all_idx(size * samples);
+    MPI_Allgather(sample_keys.data(), samples, mpi_type<T>::get(), all_keys.data(), samples, mpi_type<T>::get(),
+                  grid.comm);
+    MPI_Allgather(sample_idx.data(), samples, mpi_type<I>::get(), all_idx.data(), samples, mpi_type<I>::get(),
+                  grid.comm);
+
+    // Las muestras de bloques vacíos (índice n) van al final aunque su llave sea cualquiera
+    auto sample_less = [&](const Entry& a, const Entry& b) {
+        if ((a.second == n) != (b.second == n)) return b.second == n;
+        return indexed_comp(a, b);
+    };
+    std::vector<Entry> all_samples(size * samples);
+    for (size_t i = 0; i < all_samples.size(); ++i) all_samples[i] = {all_keys[i], all_idx[i]};
+    std::sort(all_samples.begin(), all_samples.end(), sample_less);
+    std::vector<Entry> splitters(samples);
+    for (int k = 0; k < samples; ++k) splitters[k] = all_samples[static_cast<size_t>(k + 1) * samples];
+
+    // Cubeta d: las llaves entre los splitters d - 1 y d
+    std::vector<int> send_counts(size), send_displs(size, 0), recv_counts(size), recv_displs(size, 0);
+    int begin = 0;
+    for (int d = 0; d < size; ++d) {
+        int end = d < samples
+            ? std::lower_bound(sorted.begin(), sorted.end(), splitters[d], sample_less) - sorted.begin()
+            : local_count;
+        end = std::max(end, begin);
+        send_counts[d] = end - begin;
+        begin = end;
+    }
+    std::partial_sum(send_counts.begin(), send_counts.end() - 1, send_displs.begin() + 1);
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, grid.comm);
+    std::partial_sum(recv_counts.begin(), recv_counts.end() - 1, recv_displs.begin() + 1);
+    t4 = MPI_Wtime();
+
+    // REPARTO (3): solo las llaves; el orden de origen basta para desempatar
+
+    t5 = begin_phase(PHASE_BROADCAST);
+    for (int i = 0; i < local_count; ++i) local_block[i] = sorted[i].first;
+    int bucket_size = recv_displs[size - 1] + recv_counts[size - 1];
+    std::vector<T> bucket(bucket_size);
+    MPI_Alltoallv(local_block.data(), send_counts.data(), send_displs.data(), mpi_type<T>::get(),
+                  bucket.data(), recv_counts.data(), recv_displs.data(), mpi_type<T>::get(), grid.comm);
+    t6 = MPI_Wtime();
+
+    // SORT (4), mezcla: los tramos llegan en orden de proceso de origen, es decir de índice global,
+    // y la mezcla estable conserva ese orden entre llaves iguales
+
+    double merge_start = begin_phase(PHASE_SORT);
+    std::vector<size_t> bounds(size + 1, 0);
+    for (int s = 0; s < size; ++s) bounds[s + 1] = bounds[s] + recv_counts[s];
+    merge_sorted_runs(options.pool, bucket, bounds, comp);
+    t8 = t7 + sort_time + (MPI_Wtime() - merge_start);
+
+    // SALIDA
+
+    std::vector<T> output;
+    ws.input_counts.resize(size);
+    MPI_Allgather(&bucket_size, 1, MPI_INT, ws.input_counts.data(), 1, MPI_INT, grid.comm);
+    if (options.output == OutputMode::Distributed) {
+        t15 = begin_phase(PHASE_PLACEMENT);
+        output.resize(local_count);
+        rebalance_input(grid, KeySpan<T>(bucket), n, ws, output.data(), local_count);
+        t16 = MPI_Wtime();
+    } else {
+        t13 = begin_phase(PHASE_GATHER);
+        std::vector<int> displs(size, 0);
+        if (fits_int_count(n)) std::partial_sum(ws.input_counts.begin(), ws.input_counts.end() - 1, displs.begin() + 1);
+        if (grid.rank == 0) output.resize(n);
+        gatherv_large(bucket.data(), bucket_size, mpi_type<T>::get(), output.data(), ws.input_counts, displs, n, 0,
+                      grid.comm);
+        t14 = MPI_Wtime();
+    }
+    current_phase = PHASE_OTHER;
+    return output;
+}
+
+template <typename T, typename Compare = std::less<T>>
+std::vector<T> sample_sort(const Grid& grid, const std::vector<T>& input, Compare comp = Compare(),
+                           const SortOptions& options = SortOptions()) {
+    long long n = input.size();
+    MPI_Bcast(&n, 1, MPI_LONG_LONG, 0, grid.comm);
+    reset_phase_timers();
+    if (n > RANK32_MAX_N) return indexed_sample_sort<int64_t>(grid, input, n, comp, options);
+    return indexed_sample_sort<int>(grid, input, n, comp, options);
+}
+
+// Ordenamiento por ranking o sample sort según el algoritmo pedido; con Auto, sample sort desde
+// crossover llaves (medido con ./benchmark --algorithm=both o predicho con cost_model.hpp)
+template <typename T, typename Compare = std::less<T>>
+std::vector<T> distributed_sort(const Grid& grid, const std::vector<T>& input, Compare comp = Compare(),
+                                const SortOptions& options = SortOptions(), SortAlgorithm algorithm = SortAlgorithm::Auto,
+                                long long crossover = SAMPLE_SORT_MIN_N) {
+    if (algorithm == SortAlgorithm::Auto) {
+        long long n = input.size();
+        MPI_Bcast(&n, 1, MPI_LONG_LONG, 0, grid.comm);
+        algorithm = n >= crossover ? SortAlgorithm::Sample : SortAlgorithm::Rank;
+    }
+    if (algorithm == SortAlgorithm::Sample) return sample_sort(grid, input, comp, options);
+    return grid_rank_sort(grid, input, comp, options);
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+// Pool fijo de hilos con robo de trabajo, para el modo híbrido (MPI + hilos) y el motor sin MPI
+// (threaded_rank_sort.hpp). Cada hilo tiene su cola: toma sus tareas por detrás y, si se queda sin
+// trabajo, roba por delante de las colas de los demás. El hilo que llama a parallel_for también
+// trabaja y es el único que hace llamadas MPI, así que basta con MPI_THREAD_FUNNELED.
+class ThreadPool {
+public:
+    // threads cuenta al hilo que llama: con threads = 1 no se crea ningún hilo extra
+    explicit ThreadPool(int threads) : threads(std::max(1, threads)) {
+        for (int i = 0; i < this->threads; ++i) queues.emplace_back(new Queue);
+        for (int i = 1; i < this->threads; ++i) workers.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (std::thread& w : workers) w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return threads; }
+
+    // Reparte [0, count) en tramos consecutivos de al menos min_grain elementos y llama fn(begin, end)
+    // en cada uno; vuelve cuando terminaron todos. Mientras espera, el que llama ejecuta o roba tareas,
+    // así que también puede usarse desde dentro de una tarea.
+    template <typename F>
+    void parallel_for(size_t count, F&& fn, size_t min_grain = 1, size_t parts = 0) {
+        if (parts == 0) parts = threads;
+        parts = std::min(parts, count / std::max<size_t>(min_grain, 1));
+        if (parts <= 1) {
+            if (count > 0) fn(size_t(0), count);
+            return;
+        }
+
+        size_t self = current_pool == this ? current_index : 0;
+        std::atomic<size_t> pending(parts - 1);
+        for (size_t k = 1; k < parts; ++k) {
+            size_t begin = count * k / parts, end = count * (k + 1) / parts;
+            push((self + k) % threads, [&fn, &pending, begin, end] {
+                fn(begin, end);
+                pending--;
+            });
+        }
+        {
+            // Tomar el mutex garantiza que ningún hilo quede dormido con tareas ya encoladas
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_all();
+
+        fn(size_t(0), count / parts);
+        std::function<void()> task;
+        while (pending > 0) {
+            if (pop(self, task)) task();
+            else std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(size_t q, std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(queues[q]->mutex);
+        queues[q]->tasks.push_back(std::move(task));
+        queued++;
+    }
+
+    // Primero la cola propia (la última tarea encolada, que suele estar caliente en caché),
+    // después robo de la más antigua de las demás
+    bool pop(size_t self, std::function<void()>& task) {
+        for (size_t k = 0; k < queues.size(); ++k) {
+            Queue& q = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            if (k == 0) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+            } else {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    void worker_loop(size_t index) {
+        current_pool = this;
+        current_index = index;
+        std::function<void()> task;
+        for (;;) {
+            if (pop(index, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] { return stop || queued > 0; });
+            if (stop && queued == 0) return;
+        }
+    }
+
+    static inline thread_local const ThreadPool* current_pool = nullptr;
+    static inline thread_local size_t current_index = 0;
+
+    int threads;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stop = false;
+};
+
+// Ejecuta en paralelo si hay pool; si no, fn(0, count) en el hilo actual
+template <typename F>
+void parallel_for(ThreadPool* pool, size_t count, F&& fn, size_t min_grain = 1) {
+    if (pool) pool->parallel_for(count, fn, min_grain);
+    else if (count > 0) fn(size_t(0), count);
+}
+
+// Tramo mínimo por tarea: por debajo de esto el costo de repartir supera al del trabajo
+const size_t PARALLEL_MIN_GRAIN = 1 << 12;
+
+// Mezcla de a pares los tramos ordenados [bounds[k], bounds[k + 1]) de data, cada ronda en paralelo.
+// Estable: ante llaves equivalentes queda primero la del tramo anterior.
+template <typename T, typename Compare>
+void merge_sorted_runs(ThreadPool* pool, std::vector<T>& data, const std::vector<size_t>& bounds, Compare comp) {
+    size_t parts = bounds.size() - 1;
+    if (parts <= 1) return;
+
+    std::vector<T> buffer(data.size());
+    for (size_t width = 1; width < parts; width *= 2) {
+        size_t pairs = (parts + 2 * width - 1) / (2 * width);
+        parallel_for(pool, pairs, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                size_t first = bounds[2 * width * k];
+                size_t middle = bounds[std::min(parts, 2 * width * k + width)];
+                size_t last = bounds[std::min(parts, 2 * width * (k + 1))];
+                std::merge(data.begin() + first, data.begin() + middle, data.begin() + middle, data.begin() + last,
+                           buffer.begin() + first, comp);
+            }
+        });
+        data.swap(buffer);
+    }
+}
+
+// Sort paralelo: cada hilo ordena un tramo y luego los tramos se mezclan de a pares,
+// cada ronda de mezclas también en paralelo.
+template <typename T, typename Compare>
+void parallel_sort(ThreadPool* pool, std::vector<T>& data, Compare comp) {
+    size_t parts = pool ? std::min<size_t>(pool->size(), data.size() / PARALLEL_MIN_GRAIN) : 1;
+    if (parts <= 1) {
+        std::sort(data.begin(), data.end(), comp);
+        return;
+    }
+
+    std::vector<size_t> bounds(parts + 1);
+    for (size_t k = 0; k <= parts; ++k) bounds[k] = data.size() * k / parts;
+
+    pool->parallel_for(parts, [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) std::sort(data.begin() + bounds[k], data.begin() + bounds[k + 1], comp);
+    });
+    merge_sorted_runs(pool, data, bounds, comp);
+}
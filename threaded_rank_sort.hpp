@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+
+#include "blocks.hpp"
+#include "local_rank.hpp"
+
+// Motor sin MPI: el mismo algoritmo de main.cpp dentro de un proceso, con cada "proceso" de la malla
+// convertido en una tarea del pool (con robo de trabajo) y los mensajes en lecturas de memoria compartida.
+//  - Reparto:   el bloque i sigue siendo [i*n/p, (i+1)*n/p) de la entrada; no hay scatter.
+//  - Gossip:    cada bloque de columna se arma una vez (una tarea por columna).
+//  - Broadcast: el bloque de fila es un tramo contiguo de la entrada, se lee sin copiar.
+//  - Ranking:   una tarea por celda (fila, columna), con los mismos kernels de local_rank.hpp.
+//  - Reduce:    una tarea por bloque suma los ranks parciales de su fila y ubica sus llaves.
+
+// Malla rows x cols de tareas sobre un pool de hilos; equivale a Grid sin comunicadores
+struct ThreadGrid {
+    int rows, cols;
+    ThreadPool* pool;
+};
+
+// Por defecto una celda por hilo; con más celdas que hilos el robo de trabajo reparte la carga
+inline ThreadGrid make_thread_grid(ThreadPool& pool, int tasks = 0) {
+    ThreadGrid grid;
+    grid.pool = &pool;
+    choose_grid_shape(tasks > 0 ? tasks : pool.size(), grid.rows, grid.cols);
+    return grid;
+}
+
+/**
+ * @brief Ordena por ranking en una malla de tareas (sin MPI).
+ *
+ * Misma interfaz que la versión MPI de grid_rank_sort, con ThreadGrid en lugar de Grid: recibe la
+ * entrada completa y devuelve la salida ordenada completa. Los ranks son estables (desempate por
+ * índice), así que el resultado es el mismo que el de la versión MPI.
+ *
+ * @param comp Orden estricto débil sobre las llaves (por defecto std::less<T>).
+ */
+template <typename T, typename Compare = std::less<T>>
+std::vector<T> grid_rank_sort(const ThreadGrid& grid, const std::vector<T>& input, Compare comp = Compare()) {
+    ThreadPool& pool = *grid.pool;
+    int size = grid.rows * grid.cols;
+    long long n = input.size();
+    if (n == 0) return {};
+
+    auto row_begin = [&](int r) { return block_start(r * grid.cols, n, size); };
+
+    // GOSSIP
+    // Columna c: bloques c, c + cols, ... uno tras otro, con sus índices globales de origen
+
+    std::vector<std::vector<T>> columns(grid.cols);
+    std::vector<std::vector<int>> column_idx(grid.cols);
+    pool.parallel_for(grid.cols, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            for (int r = 0; r < grid.rows; ++r) {
+                int block = r * grid.cols + c;
+                long long first = block_start(block, n, size), last = block_start(block + 1, n, size);
+                columns[c].insert(columns[c].end(), input.begin() + first, input.begin() + last);
+                for (long long i = first; i < last; ++i) column_idx[c].push_back(static_cast<int>(i));
+            }
+        }
+    }, 1, grid.cols);
+
+    // Un solo kernel para toda la malla: los tamaños de columna y fila difieren a lo más en uno
+    KernelChoice choice;
+    choice.kernel = sorted_rank_kernel(columns[0].size(), row_begin(1) - row_begin(0));
+    if constexpr (counting_applicable<T, Compare>()) {
+        auto [lo, hi] = std::minmax_element(input.begin(), input.end(), comp);
+        choice = choose_rank_kernel(*lo, *hi, columns[0].size(), row_begin(1) - row_begin(0), comp);
+    }
+
+    // SORT
+    // Cada columna se ordena una sola vez, aunque la usen todas las celdas de la columna
+
+    IndexedCompare<Compare> indexed_comp{comp};
+    std::vector<std::vector<Indexed<T>>> sorted_columns(grid.cols);
+    if (choice.kernel != RankKernel::Counting) {
+        pool.parallel_for(grid.cols, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                sorted_columns[c] = with_indices(columns[c], column_idx[c]);
+                std::sort(sorted_columns[c].begin(), sorted_columns[c].end(), indexed_comp);
+            }
+        }, 1, grid.cols);
+    }
+
+    // LOCAL RANKING
+    // Celda (r, c): la fila r (tramo contiguo de la entrada) contra la columna c
+
+    std::vector<std::vector<int>> partial(size);
+    pool.parallel_for(size, [&](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; ++cell) {
+            int r = cell / grid.cols, c = cell % grid.cols;
+            KeySpan<T> row(input.data() + row_begin(r), row_begin(r + 1) - row_begin(r));
+            std::vector<int> row_idx(row.size());
+            std::iota(row_idx.begin(), row_idx.end(), static_cast<int>(row_begin(r)));
+
+            bool counted = false;
+            if constexpr (counting_applicable<T, Compare>()) {
+                if (choice.kernel == RankKernel::Counting) {
+                    partial[cell] = local_rank_counting(KeySpan<T>(columns[c]), column_idx[c], row, row_idx,
+                                                        choice.lo, choice.span);
+                    counted = true;
+                }
+            }
+            if (!counted) partial[cell] = local_rank(choice, sorted_columns[c], with_indices(row, row_idx), indexed_comp);
+        }
+    }, 1, size);
+
+    // REDUCE y ubicación
+    // El bloque b = r*cols + c suma su tramo de los ranks parciales de la fila r y escribe sus llaves
+
+    std::vector<T> output(n);
+    pool.parallel_for(size, [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block) {
+            int r = block / grid.cols;
+            long long first = block_start(block, n, size), last = block_start(block + 1, n, size);
+            for (long long i = first; i < last; ++i) {
+                size_t offset = i - row_begin(r);
+                int rank = 0;
+                for (int c = 0; c < grid.cols; ++c) rank += partial[r * grid.cols + c][offset];
+                output[rank] = input[i];
+            }
+        }
+    }, 1, size);
+
+    return output;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <mpi.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
+
+#include "grid_rank_sort.hpp"
+
+// Generador de entradas determinista y paralelo. La llave i es una función pura de (semilla, i, n,
+// distribución): un hash de contador (splitmix64), sin estado entre llaves. Cada proceso genera solo
+// su bloque [rank*n/p, (rank+1)*n/p) y el arreglo completo es el mismo con cualquier p, así que una
+// corrida se repite bit a bit con la misma semilla.
+//
+// Distribuciones:
+//  - uniform:    llaves uniformes en todo el rango del tipo (char: alfanuméricos).
+//  - zipf:       ZIPF_VALUES valores distintos con frecuencia proporcional a 1/r^ZIPF_EXPONENT.
+//  - few-unique: FEW_UNIQUE_VALUES valores distintos, equiprobables.
+//  - sorted, reverse, organ-pipe: ascendente, descendente, y ascendente hasta n/2 y luego descendente.
+
+enum class Distribution { Uniform, Zipf, FewUnique, Sorted, Reverse, OrganPipe };
+
+const uint64_t DEFAULT_SEED = 1;
+const double ZIPF_EXPONENT = 1.1;
+const int ZIPF_VALUES = 1 << 16;
+const int FEW_UNIQUE_VALUES = 16;
+
+// Los mismos 62 alfanuméricos de siempre, en orden ASCII para que sorted sea ascendente
+inline const char KEY_CHARACTERS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+const int NUM_KEY_CHARACTERS = sizeof(KEY_CHARACTERS) - 1;
+
+// false si el nombre no es una distribución
+inline bool parse_distribution(const std::string& name, Distribution& dist) {
+    const char* names[] = {"uniform", "zipf", "few-unique", "sorted", "reverse", "organ-pipe"};
+    for (int d = 0; d < 6; ++d) {
+        if (name == names[d]) {
+            dist = static_cast<Distribution>(d);
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// 64 bits pseudoaleatorios para el contador i del flujo stream
+inline uint64_t counter_hash(uint64_t seed, uint64_t stream, uint64_t i) {
+    return splitmix64(splitmix64(seed ^ (stream * 0xd1b54a32d192ed03ULL)) + i);
+}
+
+inline double unit_interval(uint64_t bits) {
+    return (bits >> 11) * (1.0 / 9007199254740992.0); // [0, 1) con 53 bits
+}
+
+// Llave uniforme a partir de 64 bits aleatorios
+template <typename T>
+T key_from_bits(uint64_t bits) {
+    if constexpr (std::is_same<T, char>::value) {
+        return KEY_CHARACTERS[((bits >> 32) * NUM_KEY_CHARACTERS) >> 32];
+    } else if constexpr (std::is_floating_point<T>::value) {
+        return static_cast<T>(unit_interval(bits));
+    } else {
+        return static_cast<T>(bits);
+    }
+}
+
+// Llave de la posición i en un orden ascendente de n llaves
+template <typename T>
+T ordered_key(long long i, long long n) {
+    if constexpr (std::is_same<T, char>::value) {
+        return KEY_CHARACTERS[static_cast<long long>(static_cast<double>(i) * NUM_KEY_CHARACTERS / n)];
+    } else if constexpr (std::is_floating_point<T>::value) {
+        return static_cast<T>(static_cast<double>(i) / n);
+    } else {
+        return static_cast<T>(i);
+    }
+}
+
+// Distribución acumulada de Zipf sobre values valores; la misma tabla en todos los procesos
+inline std::vector<double> zipf_cdf(int values, double exponent) {
+    std::vector<double> cdf(values);
+    double sum = 0;
+    for (int r = 0; r < values; ++r) cdf[r] = sum += 1.0 / std::pow(r + 1, exponent);
+    for (double& c : cdf) c /= sum;
+    return cdf;
+}
+
+/**
+ * @brief Genera las llaves [first, first + count) de la entrada de n llaves.
+ *
+ * Función pura de (dist, seed, n, first, count): cualquier proceso puede generar cualquier tramo.
+ */
+template <typename T>
+std::vector<T> generate_keys(Distribution dist, long long n, long long first, long long count,
+                             uint64_t seed = DEFAULT_SEED) {
+    std::vector<T> keys(count);
+    switch (dist) {
+    case Distribution::Uniform:
+        for (long long i = 0; i < count; ++i) keys[i] = key_from_bits<T>(counter_hash(seed, 0, first + i));
+        break;
+    case Distribution::Zipf: {
+        // El valor de rango r es una llave uniforme fija, así que los frecuentes quedan dispersos
+        std::vector<double> cdf = zipf_cdf(ZIPF_VALUES, ZIPF_EXPONENT);
+        for (long long i = 0; i < count; ++i) {
+            double u = unit_interval(counter_hash(seed, 0, first + i));
+            uint64_t r = std::lower_bound(cdf.begin(), cdf.end() - 1, u) - cdf.begin();
+            keys[i] = key_from_bits<T>(counter_hash(seed, 1, r));
+        }
+        break;
+    }
+    case Distribution::FewUnique:
+        for (long long i = 0; i < count; ++i) {
+            uint64_t v = counter_hash(seed, 0, first + i) % FEW_UNIQUE_VALUES;
+            keys[i] = key_from_bits<T>(counter_hash(seed, 1, v));
+        }
+        break;
+    case Distribution::Sorted:
+        for (long long i = 0; i < count; ++i) keys[i] = ordered_key<T>(first + i, n);
+        break;
+    case Distribution::Reverse:
+        for (long long i = 0; i < count; ++i) keys[i] = ordered_key<T>(n - 1 - (first + i), n);
+        break;
+    case Distribution::OrganPipe:
+        for (long long i = 0; i < count; ++i) {
+            long long g = first + i;
+            keys[i] = ordered_key<T>(g < (n + 1) / 2 ? 2 * g : 2 * (n - 1 - g) + 1, n);
+        }
+        break;
+    }
+    return keys;
+}
+
+// El bloque [rank*n/p, (rank+1)*n/p) del proceso, la entrada de rank_sort y read_block
+template <typename T>
+std::vector<T> generate_block(MPI_Comm comm, Distribution dist, long long n, uint64_t seed = DEFAULT_SEED) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    return generate_keys<T>(dist, n, block_start(rank, n, size), block_size(rank, n, size), seed);
+}
+
+// La entrada completa en el proceso 0 (grid_rank_sort, sample_sort): cada proceso genera su bloque
+// y se juntan con un Gatherv, fuera de la medición
+template <typename T>
+std::vector<T> generate_input(MPI_Comm comm, Distribution dist, long long n, uint64_t seed = DEFAULT_SEED) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    std::vector<T> block = generate_block<T>(comm, dist, n, seed);
+
+    std::vector<int> all_blocks(size), counts, displs;
+    std::iota(all_blocks.begin(), all_blocks.end(), 0);
+    block_counts(all_blocks, n, size, counts, displs);
+    std::vector<T> input(rank == 0 ? n : 0);
+    gatherv_large(block.data(), static_cast<int>(block.size()), mpi_type<T>::get(), input.data(), counts, displs, n, 0,
+                  comm);
+    return input;
+}